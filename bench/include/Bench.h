@@ -0,0 +1,81 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Minimal self-contained microbenchmark harness. Each benchmark is a body
+// that performs the measured operation a given number of times; the harness
+// picks that number so one sample lasts at least `minSampleTime`, then
+// reports statistics over several samples in ns per operation.
+namespace Bench {
+
+// Keeps the compiler from optimizing away a value or the code producing it
+template <typename T> inline void DoNotOptimize(const T &value) {
+#if defined(__GNUC__) || defined(__clang__)
+  asm volatile("" : : "m"(value) : "memory");
+#else
+  static volatile const void *sink;
+  sink = &value;
+#endif
+}
+
+struct Options {
+  double minSampleTime = 0.01; // s
+  int samples = 15;
+  std::string filter;   // Substring a benchmark name must contain
+  std::string jsonPath; // Results are also written here when set
+};
+
+// Statistics in ns per operation
+struct Result {
+  std::string name;
+  uint64_t iterations = 0; // Per sample
+  int samples = 0;
+  double median = 0.0;
+  double mean = 0.0;
+  double min = 0.0;
+  double max = 0.0;
+  double stddev = 0.0;
+};
+
+// Runs the measured operation `iterations` times
+using Body = std::function<void(uint64_t iterations)>;
+// Prepares shared state once, before the first sample
+using Setup = std::function<void()>;
+
+class Suite {
+private:
+  struct Benchmark {
+    std::string name;
+    Setup setup;
+    Body body;
+  };
+  std::vector<Benchmark> benchmarks;
+
+public:
+  void Add(const std::string &name, const Body &body);
+  void Add(const std::string &name, const Setup &setup, const Body &body);
+
+  // Runs every benchmark matching the filter and prints one line per result
+  std::vector<Result> Run(const Options &options) const;
+};
+
+// Reads --filter=, --json=, --min-time= and --samples=. Throws
+// std::invalid_argument on anything else.
+Options ParseArguments(int argc, char **argv);
+
+// Peak resident set size of the process in bytes, or 0 where unknown
+size_t PeakMemory();
+// Restarts PeakMemory() from the current resident set size. Only Linux
+// supports this; elsewhere the peak keeps covering the whole process, and
+// the function returns false.
+bool ResetPeakMemory();
+
+// Results plus the build context (compiler, build type, date), so files
+// from different releases can be compared
+void WriteJson(std::ostream &out, const std::vector<Result> &results);
+
+} // namespace Bench
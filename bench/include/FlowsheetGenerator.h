@@ -0,0 +1,48 @@
+#pragma once
+#include "Simulator.h"
+#include <cstddef>
+#include <string>
+
+// Synthetic evaporation plants of any size, for scaling studies. A plant
+// is a number of independent multiple-effect trains; steam enters the first
+// effect of each train and every effect's vapour heats the next one. The
+// liquor path sets the recycle structure:
+//   Forward   liquor follows the vapour: acyclic
+//   Backward  liquor runs against the vapour: every pair of adjacent effects
+//             closes a loop, all chained into one component per train
+//   Mixed     liquor enters the middle effect, runs forward to the last one
+//             and then backward from the effect before it to the first:
+//             an outer loop around the backward section's loops
+namespace FlowsheetGenerator {
+
+enum class Feed { Forward, Backward, Mixed };
+
+const char *FeedName(Feed feed);
+// Throws std::invalid_argument for an unknown name
+Feed ParseFeed(const std::string &name);
+
+struct Options {
+  size_t effects = 5; // Per train
+  size_t trains = 1;
+  Feed feed = Feed::Backward;
+
+  // Operating point of the first train; later trains deviate by up to
+  // `spread` (relative) so they do not all follow the same iterates
+  double steamFlow = 4.0;      // kg/s
+  double steamPressure = 3.0;  // bar
+  double feedFlow = 40.0;      // kg/s
+  double feedTemperature = 80; // °C
+  double feedSolids = 0.15;
+  double area = 2000.0; // m² per effect
+  double U = 0.5;       // kW/m²K
+  double spread = 0.05;
+
+  // Build the blocks, pins, methods and connectors in a FlowsheetArena
+  bool arena = true;
+};
+
+// Blocks are named T<train>E<effect> and use Evaporator::MethodGivenInletData.
+// No connector is marked as a tear stream.
+Flowsheet EvaporatorTrains(const Options &options);
+
+} // namespace FlowsheetGenerator
@@ -0,0 +1,222 @@
+#include "Bench.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <stdexcept>
+#include <thread>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+#ifndef SIM_BENCH_BUILD_TYPE
+#define SIM_BENCH_BUILD_TYPE "unknown"
+#endif
+
+namespace Bench {
+
+namespace {
+
+double TimeSample(const Body &body, uint64_t iterations) {
+  auto start = std::chrono::steady_clock::now();
+  body(iterations);
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double>(end - start).count();
+}
+
+// Iterations for one sample to last at least `minTime`
+uint64_t Calibrate(const Body &body, double minTime) {
+  uint64_t iterations = 1;
+  for (;;) {
+    double elapsed = TimeSample(body, iterations);
+    if (elapsed >= minTime) {
+      return iterations;
+    }
+    // Aim 20% past the target, growing at most 100x per round
+    double factor = elapsed > 0.0 ? 1.2 * minTime / elapsed : 100.0;
+    factor = std::min(std::max(factor, 2.0), 100.0);
+    iterations = static_cast<uint64_t>(std::ceil(iterations * factor));
+  }
+}
+
+Result Measure(const std::string &name, const Body &body,
+               const Options &options) {
+  Result result;
+  result.name = name;
+  result.iterations = Calibrate(body, options.minSampleTime);
+  result.samples = std::max(options.samples, 1);
+
+  std::vector<double> ns(result.samples);
+  for (double &sample : ns) {
+    sample = TimeSample(body, result.iterations) * 1e9 / result.iterations;
+  }
+  std::sort(ns.begin(), ns.end());
+
+  size_t n = ns.size();
+  result.min = ns.front();
+  result.max = ns.back();
+  result.median = n % 2 ? ns[n / 2] : 0.5 * (ns[n / 2 - 1] + ns[n / 2]);
+  for (double sample : ns) {
+    result.mean += sample / n;
+  }
+  for (double sample : ns) {
+    result.stddev += (sample - result.mean) * (sample - result.mean) / n;
+  }
+  result.stddev = std::sqrt(result.stddev);
+  return result;
+}
+
+std::string Compiler() {
+#if defined(__clang__)
+  return std::string("clang ") + __clang_version__;
+#elif defined(__GNUC__)
+  return std::string("gcc ") + __VERSION__;
+#elif defined(_MSC_VER)
+  return "msvc " + std::to_string(_MSC_VER);
+#else
+  return "unknown";
+#endif
+}
+
+std::string Escape(const std::string &text) {
+  std::string escaped;
+  for (char c : text) {
+    if (c == '"' || c == '\\') {
+      escaped += '\\';
+    }
+    escaped += c;
+  }
+  return escaped;
+}
+
+} // namespace
+
+void Suite::Add(const std::string &name, const Body &body) {
+  benchmarks.push_back({name, nullptr, body});
+}
+
+void Suite::Add(const std::string &name, const Setup &setup,
+                const Body &body) {
+  benchmarks.push_back({name, setup, body});
+}
+
+std::vector<Result> Suite::Run(const Options &options) const {
+  std::vector<Result> results;
+  std::string buildType = SIM_BENCH_BUILD_TYPE;
+  if (buildType != "Release" && buildType != "RelWithDebInfo") {
+    std::fprintf(stderr,
+                 "Warning: %s build, timings do not reflect optimized code\n",
+                 buildType.empty() ? "unoptimized" : buildType.c_str());
+  }
+  std::printf("%-40s %12s %12s %10s %12s\n", "benchmark", "median ns",
+              "min ns", "stddev %", "iterations");
+  for (const auto &benchmark : benchmarks) {
+    if (benchmark.name.find(options.filter) == std::string::npos) {
+      continue;
+    }
+    if (benchmark.setup) {
+      benchmark.setup();
+    }
+    Result result = Measure(benchmark.name, benchmark.body, options);
+    std::printf("%-40s %12.2f %12.2f %10.1f %12llu\n", result.name.c_str(),
+                result.median, result.min,
+                100.0 * result.stddev / result.mean,
+                static_cast<unsigned long long>(result.iterations));
+    std::fflush(stdout);
+    results.push_back(result);
+  }
+  return results;
+}
+
+Options ParseArguments(int argc, char **argv) {
+  Options options;
+  for (int i = 1; i < argc; ++i) {
+    std::string argument = argv[i];
+    // Copies the text after `prefix` if the argument starts with it
+    auto take = [&](const std::string &prefix, std::string &text) {
+      if (argument.compare(0, prefix.size(), prefix) != 0) {
+        return false;
+      }
+      text = argument.substr(prefix.size());
+      return true;
+    };
+
+    std::string text;
+    if (take("--filter=", options.filter) ||
+        take("--json=", options.jsonPath)) {
+      continue;
+    }
+    if (take("--min-time=", text)) {
+      options.minSampleTime = std::stod(text);
+    } else if (take("--samples=", text)) {
+      options.samples = std::stoi(text);
+    } else {
+      throw std::invalid_argument("Unknown argument " + argument);
+    }
+  }
+  return options;
+}
+
+size_t PeakMemory() {
+#ifdef __linux__
+  // VmHWM follows ResetPeakMemory(), unlike getrusage()
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line)) {
+    if (line.compare(0, 6, "VmHWM:") == 0) {
+      return std::stoull(line.substr(6)) * 1024; // kB
+    }
+  }
+#endif
+#if defined(__APPLE__)
+  rusage usage;
+  return getrusage(RUSAGE_SELF, &usage) == 0 ? usage.ru_maxrss : 0; // Bytes
+#elif defined(__unix__)
+  rusage usage;
+  return getrusage(RUSAGE_SELF, &usage) == 0 ? usage.ru_maxrss * 1024 : 0;
+#else
+  return 0;
+#endif
+}
+
+bool ResetPeakMemory() {
+#ifdef __linux__
+  std::ofstream clearRefs("/proc/self/clear_refs");
+  clearRefs << "5";
+  clearRefs.flush();
+  return static_cast<bool>(clearRefs);
+#else
+  return false;
+#endif
+}
+
+void WriteJson(std::ostream &out, const std::vector<Result> &results) {
+  char date[32];
+  std::time_t now = std::time(nullptr);
+  std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+  out << "{\n";
+  out << "  \"context\": {\n";
+  out << "    \"date\": \"" << date << "\",\n";
+  out << "    \"compiler\": \"" << Escape(Compiler()) << "\",\n";
+  out << "    \"build_type\": \"" << SIM_BENCH_BUILD_TYPE << "\",\n";
+  out << "    \"hardware_threads\": " << std::thread::hardware_concurrency()
+      << ",\n";
+  out << "    \"unit\": \"ns\"\n";
+  out << "  },\n";
+  out << "  \"benchmarks\": [";
+  for (size_t i = 0; i < results.size(); ++i) {
+    const Result &r = results[i];
+    out << (i ? "," : "") << "\n    {\"name\": \"" << Escape(r.name)
+        << "\", \"iterations\": " << r.iterations
+        << ", \"samples\": " << r.samples << ", \"median\": " << r.median
+        << ", \"mean\": " << r.mean << ", \"min\": " << r.min
+        << ", \"max\": " << r.max << ", \"stddev\": " << r.stddev << "}";
+  }
+  out << "\n  ]\n}\n";
+}
+
+} // namespace Bench
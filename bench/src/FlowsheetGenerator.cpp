@@ -0,0 +1,123 @@
+#include "FlowsheetGenerator.h"
+#include "Evaporator.h"
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+namespace FlowsheetGenerator {
+
+namespace {
+
+std::string BlockId(size_t train, size_t effect) {
+  return "T" + std::to_string(train) + "E" + std::to_string(effect);
+}
+
+// Effects in the order the liquor passes through them
+std::vector<size_t> LiquorPath(Feed feed, size_t effects) {
+  std::vector<size_t> path;
+  switch (feed) {
+  case Feed::Forward:
+    for (size_t k = 0; k < effects; ++k) {
+      path.push_back(k);
+    }
+    break;
+  case Feed::Backward:
+    for (size_t k = effects; k-- > 0;) {
+      path.push_back(k);
+    }
+    break;
+  case Feed::Mixed:
+    for (size_t k = effects / 2; k < effects; ++k) {
+      path.push_back(k);
+    }
+    for (size_t k = effects / 2; k-- > 0;) {
+      path.push_back(k);
+    }
+    break;
+  }
+  return path;
+}
+
+// Deterministic deviation in [-1, 1) for the given train
+double Deviation(size_t train) {
+  double fraction = std::fmod(train * 0.6180339887498949, 1.0);
+  return 2.0 * fraction - 1.0;
+}
+
+} // namespace
+
+const char *FeedName(Feed feed) {
+  switch (feed) {
+  case Feed::Forward:
+    return "forward";
+  case Feed::Backward:
+    return "backward";
+  case Feed::Mixed:
+    return "mixed";
+  }
+  return "unknown";
+}
+
+Feed ParseFeed(const std::string &name) {
+  for (Feed feed : {Feed::Forward, Feed::Backward, Feed::Mixed}) {
+    if (name == FeedName(feed)) {
+      return feed;
+    }
+  }
+  throw std::invalid_argument("Unknown feed arrangement " + name);
+}
+
+Flowsheet EvaporatorTrains(const Options &options) {
+  if (options.effects == 0) {
+    throw std::invalid_argument("A train needs at least one effect");
+  }
+
+  Flowsheet flowsheet;
+  flowsheet.blocks.reserve(options.trains * options.effects);
+  flowsheet.connectors.reserve(2 * options.trains * options.effects);
+  std::vector<size_t> path = LiquorPath(options.feed, options.effects);
+  if (options.arena) {
+    flowsheet.arena = FlowsheetArena::Create();
+  }
+  FlowsheetArena::Scope scope(flowsheet.arena.get());
+
+  for (size_t t = 0; t < options.trains; ++t) {
+    double scale = 1.0 + options.spread * Deviation(t);
+
+    for (size_t k = 0; k < options.effects; ++k) {
+      std::string id = BlockId(t, k);
+      Ref<CalculationBlock> e = FlowsheetArena::MakeInCurrent<Evaporator>(
+          id, ParamsMap{
+                  {"A", options.area},
+                  {"Q", 0},
+                  {"U", options.U},
+                  {"D", 25e-3},
+              });
+
+      // Only the first effect's steam and the feed effect's liquor are
+      // inputs of the plant; the other values are replaced by connectors
+      // and serve as the initial guesses of the tear streams
+      e->SetInputPinValue("S", "m", options.steamFlow * scale);
+      e->SetInputPinValue("S", "P", options.steamPressure);
+      e->SetInputPinValue("F", "T", options.feedTemperature);
+      e->SetInputPinValue("F", "m", options.feedFlow / scale);
+      e->SetInputPinValue("F", "x", options.feedSolids);
+      e->SetCalculationMethod(
+          FlowsheetArena::MakeInCurrent<Evaporator::MethodGivenInletData>(e));
+      flowsheet.blocks.push_back(e);
+    }
+
+    for (size_t k = 0; k + 1 < options.effects; ++k) {
+      flowsheet.connectors.push_back(FlowsheetArena::MakeInCurrent<Connector>(
+          BlockId(t, k), "V", BlockId(t, k + 1), "S"));
+    }
+    for (size_t i = 0; i + 1 < path.size(); ++i) {
+      flowsheet.connectors.push_back(FlowsheetArena::MakeInCurrent<Connector>(
+          BlockId(t, path[i]), "L", BlockId(t, path[i + 1]), "F"));
+    }
+  }
+
+  return flowsheet;
+}
+
+} // namespace FlowsheetGenerator
@@ -0,0 +1,116 @@
+#include "BlackLiquor.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <functional>
+#include <random>
+#include <vector>
+
+// Compares the batched black liquor correlations, on every instruction set
+// this CPU supports, against a loop over the scalar functions.
+//
+//   blackliquor_bench [points] [repetitions]
+
+namespace {
+
+struct Points {
+  std::vector<double> T0, T, x, P, out;
+  volatile double sink = 0.0; // Keeps results alive
+};
+
+// Best time per point in ns over the repetitions
+double TimePerPoint(const std::function<void()> &run, size_t points,
+                    int repetitions) {
+  double best = 1e300;
+  for (int r = 0; r < repetitions; ++r) {
+    auto start = std::chrono::steady_clock::now();
+    run();
+    auto end = std::chrono::steady_clock::now();
+    best = std::min(best, std::chrono::duration<double>(end - start).count());
+  }
+  return best * 1e9 / points;
+}
+
+void Compare(const char *name, Points &p, int repetitions,
+             const std::function<double(size_t)> &scalar,
+             const std::function<void()> &batch) {
+  size_t n = p.x.size();
+  double scalarTime = TimePerPoint(
+      [&] {
+        for (size_t i = 0; i < n; ++i) {
+          p.out[i] = scalar(i);
+        }
+        p.sink += p.out[n / 2];
+      },
+      n, repetitions);
+  std::printf("%-22s scalar %8.2f ns", name, scalarTime);
+
+  for (auto isa : {BlackLiquor::Isa::Scalar, BlackLiquor::Isa::AVX2,
+                   BlackLiquor::Isa::AVX512}) {
+    try {
+      BlackLiquor::UseIsa(isa);
+    } catch (const std::exception &) {
+      continue;
+    }
+    double batchTime = TimePerPoint(
+        [&] {
+          batch();
+          p.sink += p.out[n / 2];
+        },
+        n, repetitions);
+    std::printf("  | %s %6.2f ns (%4.1fx)", BlackLiquor::IsaName(isa),
+                batchTime, scalarTime / batchTime);
+  }
+  std::printf("\n");
+  BlackLiquor::UseIsa(BlackLiquor::BestIsa());
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  size_t n = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100000;
+  int repetitions = argc > 2 ? std::atoi(argv[2]) : 20;
+
+  Points p;
+  std::mt19937 generator(42);
+  std::uniform_real_distribution<double> T(20.0, 180.0);
+  std::uniform_real_distribution<double> x(0.05, 0.8);
+  std::uniform_real_distribution<double> P(0.1, 10.0);
+  for (size_t i = 0; i < n; ++i) {
+    p.T0.push_back(T(generator));
+    p.T.push_back(T(generator));
+    p.x.push_back(x(generator));
+    p.P.push_back(P(generator));
+  }
+  p.out.resize(n);
+
+  std::printf("%zu points, best of %d, per point; best instruction set: %s\n",
+              n, repetitions, BlackLiquor::IsaName(BlackLiquor::BestIsa()));
+
+  Compare(
+      "h_BL", p, repetitions, [&](size_t i) { return h_BL(p.T[i], p.x[i]); },
+      [&] { h_BL(p.T.data(), p.x.data(), p.out.data(), n); });
+  Compare(
+      "cp_BL", p, repetitions, [&](size_t i) { return cp_BL(p.T[i], p.x[i]); },
+      [&] { cp_BL(p.T.data(), p.x.data(), p.out.data(), n); });
+  Compare(
+      "intCp_BL", p, repetitions,
+      [&](size_t i) { return intCp_BL(p.T0[i], p.T[i], p.x[i]); },
+      [&] { intCp_BL(p.T0.data(), p.T.data(), p.x.data(), p.out.data(), n); });
+  Compare(
+      "density_BL", p, repetitions,
+      [&](size_t i) { return density_BL(p.T[i], p.x[i]); },
+      [&] { density_BL(p.T.data(), p.x.data(), p.out.data(), n); });
+  Compare(
+      "dynamic_viscosity_BL", p, repetitions,
+      [&](size_t i) { return dynamic_viscosity_BL(p.T[i], p.x[i]); },
+      [&] { dynamic_viscosity_BL(p.T.data(), p.x.data(), p.out.data(), n); });
+  Compare(
+      "BPR_BL", p, repetitions,
+      [&](size_t i) { return BPR_BL(p.x[i], p.P[i]); },
+      [&] { BPR_BL(p.x.data(), p.P.data(), p.out.data(), n); });
+
+  return 0;
+}
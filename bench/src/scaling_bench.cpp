@@ -0,0 +1,272 @@
+#include "Bench.h"
+#include "BroydenRunner.h"
+#include "EquationOrientedRunner.h"
+#include "FlowsheetGenerator.h"
+#include "Log.h"
+#include "ParallelRunner.h"
+#include "Profiler.h"
+#include "RunStatistics.h"
+#include "Simulator.h"
+#include "WegsteinRunner.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// End-to-end scaling of the runners on generated evaporation plants of
+// growing size.
+//
+//   scaling_bench [--runner=wegstein|broyden|eo] [--threads=<n>]
+//                 [--feed=forward|backward|mixed] [--effects=<n>]
+//                 [--sizes=2,10,100,...] [--csv=<file>] [--verbose]
+//                 [--profile] [--trace=<file>] [--no-arena]
+//
+// A size is the number of blocks: trains of `effects` effects (or one
+// shorter train) up to that many blocks. With --threads the tear stream
+// runner converges the trains inside a ParallelRunner. Only warnings and
+// errors of the runners are logged unless --verbose is given. The
+// flowsheets are built in a FlowsheetArena unless --no-arena is given.
+//
+// In a build with SIM_ENABLE_PROFILING, --profile prints the profiler's
+// summary after each size and --trace writes the Chrome trace of the last
+// size.
+
+namespace {
+
+struct Arguments {
+  std::string runner = "broyden";
+  size_t threads = 0; // Serial runner
+  FlowsheetGenerator::Feed feed = FlowsheetGenerator::Feed::Backward;
+  size_t effects = 5;
+  std::vector<size_t> sizes = {2, 10, 100, 1000, 10000};
+  std::string csvPath;
+  std::string tracePath;
+  bool verbose = false;
+  bool profile = false;
+  bool arena = true;
+};
+
+std::vector<size_t> ParseSizes(const std::string &text) {
+  std::vector<size_t> sizes;
+  std::istringstream list(text);
+  std::string item;
+  while (std::getline(list, item, ',')) {
+    sizes.push_back(std::stoull(item));
+  }
+  return sizes;
+}
+
+Arguments ParseArguments(int argc, char **argv) {
+  Arguments arguments;
+  for (int i = 1; i < argc; ++i) {
+    std::string argument = argv[i];
+    // Copies the text after `prefix` if the argument starts with it
+    auto take = [&](const std::string &prefix, std::string &text) {
+      if (argument.compare(0, prefix.size(), prefix) != 0) {
+        return false;
+      }
+      text = argument.substr(prefix.size());
+      return true;
+    };
+
+    std::string text;
+    if (take("--runner=", arguments.runner) ||
+        take("--csv=", arguments.csvPath) ||
+        take("--trace=", arguments.tracePath)) {
+      continue;
+    }
+    if (argument == "--verbose") {
+      arguments.verbose = true;
+    } else if (argument == "--profile") {
+      arguments.profile = true;
+    } else if (argument == "--no-arena") {
+      arguments.arena = false;
+    } else if (take("--threads=", text)) {
+      arguments.threads = std::stoull(text);
+    } else if (take("--feed=", text)) {
+      arguments.feed = FlowsheetGenerator::ParseFeed(text);
+    } else if (take("--effects=", text)) {
+      arguments.effects = std::stoull(text);
+    } else if (take("--sizes=", text)) {
+      arguments.sizes = ParseSizes(text);
+    } else {
+      throw std::invalid_argument("Unknown argument " + argument);
+    }
+  }
+  if (arguments.effects == 0) {
+    throw std::invalid_argument("--effects must be at least 1");
+  }
+  return arguments;
+}
+
+Ref<Runner> MakeRunner(const Arguments &arguments) {
+  if (arguments.runner == "eo") {
+    return MakeRef<EquationOrientedRunner>(
+        Ref<Runner>(MakeRef<BroydenRunner>()));
+  }
+
+  bool wegstein = arguments.runner == "wegstein";
+  if (!wegstein && arguments.runner != "broyden") {
+    throw std::invalid_argument("Unknown runner " + arguments.runner);
+  }
+  if (arguments.threads > 0) {
+    Ref<TearStreamRunner> converger =
+        wegstein ? Ref<TearStreamRunner>(MakeRef<WegsteinRunner>())
+                 : Ref<TearStreamRunner>(MakeRef<BroydenRunner>());
+    return MakeRef<ParallelRunner>(arguments.threads, converger);
+  }
+  return wegstein ? Ref<Runner>(MakeRef<WegsteinRunner>())
+                  : Ref<Runner>(MakeRef<BroydenRunner>());
+}
+
+struct Measurement {
+  size_t blocks = 0;
+  size_t connectors = 0;
+  double buildTime = 0.0; // s, generating the flowsheet
+  double runTime = 0.0;   // s, Simulator::Run
+  double freeTime = 0.0;  // s, releasing the flowsheet
+  RunStatistics statistics;
+  size_t peakMemory = 0; // Bytes
+  std::string error;     // Empty if the run succeeded
+};
+
+double Seconds(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start)
+      .count();
+}
+
+Measurement Measure(const Arguments &arguments, size_t size) {
+  FlowsheetGenerator::Options options;
+  options.feed = arguments.feed;
+  options.effects = std::min(arguments.effects, size);
+  options.trains = (size + options.effects - 1) / options.effects;
+  options.arena = arguments.arena;
+
+  Measurement measurement;
+  Bench::ResetPeakMemory();
+  RunStatistics::Reset();
+  Profiler::Clear();
+
+  auto start = std::chrono::steady_clock::now();
+  auto flowsheet = std::make_unique<Flowsheet>(
+      FlowsheetGenerator::EvaporatorTrains(options));
+  measurement.buildTime = Seconds(start);
+  measurement.blocks = flowsheet->blocks.size();
+  measurement.connectors = flowsheet->connectors.size();
+
+  Simulator simulator(MakeRunner(arguments));
+  start = std::chrono::steady_clock::now();
+  try {
+    simulator.Run(*flowsheet);
+  } catch (const std::exception &e) {
+    measurement.error = e.what();
+  }
+  measurement.runTime = Seconds(start);
+
+  start = std::chrono::steady_clock::now();
+  flowsheet.reset();
+  measurement.freeTime = Seconds(start);
+
+  measurement.statistics = RunStatistics::Get();
+  measurement.peakMemory = Bench::PeakMemory();
+  return measurement;
+}
+
+void WriteCsv(std::ostream &out, const std::vector<Measurement> &rows) {
+  out << "blocks,connectors,build_s,run_s,free_s,outer_iterations,"
+         "calculate_calls,residual_evaluations,peak_rss_bytes,error\n";
+  for (const auto &row : rows) {
+    out << row.blocks << "," << row.connectors << "," << row.buildTime << ","
+        << row.runTime << "," << row.freeTime << ","
+        << row.statistics.outerIterations << ","
+        << row.statistics.calculateCalls << ","
+        << row.statistics.residualEvaluations << "," << row.peakMemory
+        << ",\"" << row.error << "\"\n";
+  }
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  Arguments arguments;
+  try {
+    arguments = ParseArguments(argc, argv);
+    MakeRunner(arguments);
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "%s\n", e.what());
+    return 2;
+  }
+  if ((arguments.profile || !arguments.tracePath.empty()) &&
+      !Profiler::Enabled) {
+    std::fprintf(stderr, "Warning: profiling is compiled out, build with "
+                         "-DSIM_ENABLE_PROFILING=ON\n");
+  }
+  Log::SetLevel(arguments.verbose ? LogLevel::Info : LogLevel::Warning);
+
+  std::string runner = arguments.runner;
+  if (arguments.threads > 0) {
+    runner += " in parallel on " + std::to_string(arguments.threads) +
+              " threads";
+  }
+  std::printf("Runner %s, %s feed, %zu effects per train, %s\n",
+              runner.c_str(), FlowsheetGenerator::FeedName(arguments.feed),
+              arguments.effects, arguments.arena ? "arena" : "heap");
+  std::printf("%8s %10s %10s %10s %10s %10s %12s %14s %9s  %s\n", "blocks",
+              "build ms", "run ms", "free ms", "us/block", "outer it",
+              "Calculate()", "residual evals", "peak MB", "status");
+
+  std::vector<Measurement> rows;
+  for (size_t size : arguments.sizes) {
+    if (size == 0) {
+      continue;
+    }
+    Measurement row = Measure(arguments, size);
+    std::printf("%8zu %10.2f %10.2f %10.2f %10.2f %10llu %12llu %14llu "
+                "%9.1f  %s\n",
+                row.blocks, 1e3 * row.buildTime, 1e3 * row.runTime,
+                1e3 * row.freeTime,
+                1e6 * row.runTime / row.blocks,
+                static_cast<unsigned long long>(row.statistics.outerIterations),
+                static_cast<unsigned long long>(row.statistics.calculateCalls),
+                static_cast<unsigned long long>(
+                    row.statistics.residualEvaluations),
+                row.peakMemory / 1048576.0,
+                row.error.empty() ? "converged" : row.error.c_str());
+    std::fflush(stdout);
+    rows.push_back(row);
+
+    if (arguments.profile) {
+      std::cout << std::endl;
+      Profiler::PrintSummary(std::cout);
+      std::cout << std::endl;
+    }
+  }
+
+  if (!arguments.tracePath.empty()) {
+    std::ofstream out(arguments.tracePath);
+    Profiler::WriteChromeTrace(out);
+    if (!out) {
+      std::fprintf(stderr, "Could not write %s\n",
+                   arguments.tracePath.c_str());
+      return 1;
+    }
+  }
+
+  if (!arguments.csvPath.empty()) {
+    std::ofstream out(arguments.csvPath);
+    WriteCsv(out, rows);
+    if (!out) {
+      std::fprintf(stderr, "Could not write %s\n", arguments.csvPath.c_str());
+      return 1;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,393 @@
+#include "Bench.h"
+#include "BlackLiquor.h"
+#include "Connectivity.h"
+#include "Evaporator.h"
+#include "FlowsheetGraph.h"
+#include "Numeric.h"
+#include "Pin.h"
+#include "Ref.h"
+#include "Steam.h"
+#include "SteamTables.h"
+#include "Streams.h"
+#include <array>
+#include <cstdio>
+#include <exception>
+#include <fstream>
+#include <vector>
+
+// Microbenchmarks of the simulator's hot paths.
+//
+//   sim_bench [--filter=<substring>] [--json=<file>] [--min-time=<s>]
+//             [--samples=<n>]
+//
+// Only meaningful on an optimized build (-DCMAKE_BUILD_TYPE=Release).
+
+using Bench::DoNotOptimize;
+
+namespace {
+
+// Inputs are cycled through so the compiler cannot hoist the work out of
+// the loop
+constexpr size_t InputCount = 64;
+
+template <typename F> std::array<double, InputCount> Inputs(F f) {
+  std::array<double, InputCount> values;
+  for (size_t i = 0; i < InputCount; ++i) {
+    values[i] = f(static_cast<double>(i) / (InputCount - 1));
+  }
+  return values;
+}
+
+const auto pressures = Inputs([](double s) { return 0.2 + 4.8 * s; });
+const auto temperatures = Inputs([](double s) { return 40.0 + 100.0 * s; });
+const auto fractions = Inputs([](double s) { return 0.1 + 0.6 * s; });
+
+Ref<CalculationBlock> MakeEvaporator(const std::string &id) {
+  Ref<CalculationBlock> e = MakeRef<Evaporator>(
+      id, ParamsMap{{"A", 2100}, {"Q", 12000}, {"U", 0.5}, {"D", 25e-3}});
+  e->SetInputPinValue("S", "m", 4.0);
+  e->SetInputPinValue("S", "P", 1.1);
+  e->SetInputPinValue("F", "T", 86.93);
+  e->SetInputPinValue("F", "m", 8.21);
+  e->SetInputPinValue("F", "x", 0.14);
+  return e;
+}
+
+void AddRefBenchmarks(Bench::Suite &suite) {
+  suite.Add("ref/copy_destroy", [](uint64_t n) {
+    const Ref<Pin> pin = MakeRef<Pin>();
+    for (uint64_t i = 0; i < n; ++i) {
+      Ref<Pin> copy(pin);
+      DoNotOptimize(copy);
+    }
+  });
+  suite.Add("ref/copy_destroy_local", [](uint64_t n) {
+    const Ref<Pin, LocalRefCount> pin = MakeRef<Pin, LocalRefCount>();
+    for (uint64_t i = 0; i < n; ++i) {
+      Ref<Pin, LocalRefCount> copy(pin);
+      DoNotOptimize(copy);
+    }
+  });
+  suite.Add("ref/create_destroy", [](uint64_t n) {
+    for (uint64_t i = 0; i < n; ++i) {
+      Ref<Pin> pin = MakeRef<Pin>();
+      DoNotOptimize(pin);
+    }
+  });
+  suite.Add("ref/adopt_destroy", [](uint64_t n) {
+    for (uint64_t i = 0; i < n; ++i) {
+      Ref<Pin> pin(new Pin());
+      DoNotOptimize(pin);
+    }
+  });
+}
+
+void AddPinBenchmarks(Bench::Suite &suite) {
+  static Pin pin("S", SteamStream::Schema());
+
+  suite.Add("pin/get_value_slot", [](uint64_t n) {
+    double sum = 0.0;
+    for (uint64_t i = 0; i < n; ++i) {
+      sum += pin.GetValue(SteamStream::P);
+      DoNotOptimize(pin);
+    }
+    DoNotOptimize(sum);
+  });
+  suite.Add("pin/set_value_slot", [](uint64_t n) {
+    for (uint64_t i = 0; i < n; ++i) {
+      pin.SetValue(SteamStream::P, pressures[i % InputCount]);
+      DoNotOptimize(pin);
+    }
+  });
+  suite.Add("pin/get_value_name", [](uint64_t n) {
+    double sum = 0.0;
+    for (uint64_t i = 0; i < n; ++i) {
+      sum += pin.GetValue("P");
+      DoNotOptimize(pin);
+    }
+    DoNotOptimize(sum);
+  });
+  suite.Add("pin/set_value_name", [](uint64_t n) {
+    for (uint64_t i = 0; i < n; ++i) {
+      pin.SetValue("P", pressures[i % InputCount]);
+      DoNotOptimize(pin);
+    }
+  });
+}
+
+void AddConnectorBenchmarks(Bench::Suite &suite) {
+  // Two evaporators in a loop: E1:V -> E2:S and E2:L -> E1:F. The graph
+  // links the pins, so compiled pushes only check that.
+  static std::vector<Ref<CalculationBlock>> blocks = {MakeEvaporator("E1"),
+                                                      MakeEvaporator("E2")};
+  static std::vector<Ref<Connector>> connectors = {
+      Ref<Connector>("E1", "V", "E2", "S"),
+      Ref<Connector>("E2", "L", "E1", "F")};
+  static FlowsheetGraph graph(blocks, connectors);
+
+  // The same loop with both connectors marked as tears: their pins keep
+  // values of their own, so every push copies
+  static std::vector<Ref<CalculationBlock>> tornBlocks = {
+      MakeEvaporator("E1"), MakeEvaporator("E2")};
+  static std::vector<Ref<Connector>> tornConnectors = [] {
+    std::vector<Ref<Connector>> connectors = {
+        Ref<Connector>("E1", "V", "E2", "S"),
+        Ref<Connector>("E2", "L", "E1", "F")};
+    for (auto &conn : connectors) {
+      conn->MarkAsTearStream(true);
+    }
+    return connectors;
+  }();
+  static FlowsheetGraph tornGraph(tornBlocks, tornConnectors);
+
+  suite.Add("connectors/push_compiled", [](uint64_t n) {
+    BlockHandle e1 = graph.FindBlock("E1");
+    for (uint64_t i = 0; i < n; ++i) {
+      PushDataAcrossConnectors(graph, e1);
+      DoNotOptimize(graph);
+    }
+  });
+  suite.Add("connectors/push_copied", [](uint64_t n) {
+    BlockHandle e1 = tornGraph.FindBlock("E1");
+    for (uint64_t i = 0; i < n; ++i) {
+      PushDataAcrossConnectors(tornGraph, e1);
+      DoNotOptimize(tornGraph);
+    }
+  });
+  suite.Add("connectors/push_by_id", [](uint64_t n) {
+    for (uint64_t i = 0; i < n; ++i) {
+      PushDataAcrossConnectors(blocks, connectors, blocks[0]);
+    }
+  });
+}
+
+// f_i = x_i^3 + x_i + 0.1 (x_{i-1} + x_{i+1}) - (i + 1)
+template <typename Vector> void Chain(const Vector &x, Vector &f) {
+  size_t n = x.size();
+  for (size_t i = 0; i < n; ++i) {
+    double left = i > 0 ? x[i - 1] : 0.0;
+    double right = i + 1 < n ? x[i + 1] : 0.0;
+    f[i] = x[i] * x[i] * x[i] + x[i] + 0.1 * (left + right) - (i + 1.0);
+  }
+}
+
+void AddNewtonBenchmarks(Bench::Suite &suite) {
+  NDNewtonRaphson::SolverOptions options;
+
+  suite.Add("newton/nd_2x2", [options](uint64_t n) {
+    NDNewtonRaphson solver(
+        [](const std::vector<double> &x) {
+          return std::vector<double>{x[0] * x[0] + x[1] * x[1] - 4.0,
+                                     x[0] - x[1]};
+        },
+        options);
+    for (uint64_t i = 0; i < n; ++i) {
+      auto result = solver.solve({1.0, pressures[i % InputCount]});
+      DoNotOptimize(result);
+    }
+  });
+  suite.Add("newton/nd_chain_16", [options](uint64_t n) {
+    NDNewtonRaphson solver(
+        [](const std::vector<double> &x) {
+          std::vector<double> f(x.size());
+          Chain(x, f);
+          return f;
+        },
+        options);
+    std::vector<double> guess(16, 1.0);
+    for (uint64_t i = 0; i < n; ++i) {
+      guess[0] = pressures[i % InputCount];
+      auto result = solver.solve(guess);
+      DoNotOptimize(result);
+    }
+  });
+  suite.Add("newton/fixed_2x2", [options](uint64_t n) {
+    FixedNewton<2> solver(options);
+    for (uint64_t i = 0; i < n; ++i) {
+      FixedNewton<2>::Vector x = {1.0, pressures[i % InputCount]};
+      auto result = solver.solve(
+          [](const FixedNewton<2>::Vector &x, FixedNewton<2>::Vector &f) {
+            f = {x[0] * x[0] + x[1] * x[1] - 4.0, x[0] - x[1]};
+          },
+          x);
+      DoNotOptimize(result);
+      DoNotOptimize(x);
+    }
+  });
+  suite.Add("newton/fixed_chain_16", [options](uint64_t n) {
+    FixedNewton<16> solver(options);
+    for (uint64_t i = 0; i < n; ++i) {
+      FixedNewton<16>::Vector x;
+      x.fill(1.0);
+      x[0] = pressures[i % InputCount];
+      auto result = solver.solve(
+          [](const FixedNewton<16>::Vector &x, FixedNewton<16>::Vector &f) {
+            Chain(x, f);
+          },
+          x);
+      DoNotOptimize(result);
+      DoNotOptimize(x);
+    }
+  });
+}
+
+// Diagonally dominant test system of size n
+void LinearSystem(size_t n, std::vector<std::vector<double>> &A,
+                  std::vector<double> &b) {
+  A.assign(n, std::vector<double>(n));
+  b.assign(n, 1.0);
+  for (size_t i = 0; i < n; ++i) {
+    for (size_t j = 0; j < n; ++j) {
+      A[i][j] = i == j ? 2.0 * n : 1.0 / (1.0 + i + 2.0 * j);
+    }
+  }
+}
+
+void AddLinearBenchmarks(Bench::Suite &suite) {
+  for (size_t size : {4, 32}) {
+    suite.Add("linear/nd_" + std::to_string(size), [size](uint64_t n) {
+      std::vector<std::vector<double>> A;
+      std::vector<double> b;
+      LinearSystem(size, A, b);
+      for (uint64_t i = 0; i < n; ++i) {
+        auto x = NDNewtonRaphson::solve_linear_system(A, b);
+        DoNotOptimize(x);
+      }
+    });
+  }
+  suite.Add("linear/fixed_4", [](uint64_t n) {
+    std::vector<std::vector<double>> A0;
+    std::vector<double> b0;
+    LinearSystem(4, A0, b0);
+    for (uint64_t i = 0; i < n; ++i) {
+      FixedNewton<4>::Matrix A;
+      FixedNewton<4>::Vector b;
+      for (size_t r = 0; r < 4; ++r) {
+        std::copy(A0[r].begin(), A0[r].end(), A[r].begin());
+        b[r] = b0[r];
+      }
+      FixedNewton<4>::solve_linear_system(A, b);
+      DoNotOptimize(b);
+    }
+  });
+}
+
+template <typename F>
+void AddProperty(Bench::Suite &suite, const std::string &name, F property) {
+  suite.Add(name, [property](uint64_t n) {
+    double sum = 0.0;
+    for (uint64_t i = 0; i < n; ++i) {
+      sum += property(i % InputCount);
+    }
+    DoNotOptimize(sum);
+  });
+}
+
+void AddBlackLiquorBenchmarks(Bench::Suite &suite) {
+  const auto &T = temperatures;
+  const auto &x = fractions;
+  const auto &P = pressures;
+  AddProperty(suite, "black_liquor/h_BL",
+              [&](size_t i) { return h_BL(T[i], x[i]); });
+  AddProperty(suite, "black_liquor/cp_BL",
+              [&](size_t i) { return cp_BL(T[i], x[i]); });
+  AddProperty(suite, "black_liquor/intCp_BL", [&](size_t i) {
+    return intCp_BL(T[i], T[InputCount - 1 - i], x[i]);
+  });
+  AddProperty(suite, "black_liquor/density_BL",
+              [&](size_t i) { return density_BL(T[i], x[i]); });
+  AddProperty(suite, "black_liquor/dynamic_viscosity_BL",
+              [&](size_t i) { return dynamic_viscosity_BL(T[i], x[i]); });
+  AddProperty(suite, "black_liquor/BPR_BL",
+              [&](size_t i) { return BPR_BL(x[i], P[i]); });
+}
+
+void AddSteamBenchmarks(Bench::Suite &suite, const std::string &backend,
+                        const Bench::Setup &select) {
+  const auto &P = pressures;
+  auto add = [&](const std::string &name, auto property) {
+    suite.Add("steam/" + backend + "/" + name, select,
+              [property](uint64_t n) {
+                double sum = 0.0;
+                for (uint64_t i = 0; i < n; ++i) {
+                  sum += property(i % InputCount);
+                }
+                DoNotOptimize(sum);
+              });
+  };
+  add("Tsat", [&](size_t i) { return Steam::Tsat(P[i]); });
+  add("hV_p", [&](size_t i) { return Steam::hV_p(P[i]); });
+  add("hL_p", [&](size_t i) { return Steam::hL_p(P[i]); });
+  // Superheated by 0-50 K
+  add("h_Tp", [&](size_t i) {
+    return Steam::h_Tp(Steam::Tsat(P[i]) + 50.0 * i / InputCount + 0.1, P[i]);
+  });
+}
+
+void AddEvaporatorBenchmarks(Bench::Suite &suite) {
+  static Ref<CalculationBlock> inletData = MakeEvaporator("E1");
+  inletData->SetCalculationMethod(
+      MakeRef<Evaporator::MethodGivenInletData>(inletData));
+
+  static Ref<CalculationBlock> outletPressure = MakeEvaporator("E2");
+  outletPressure->SetOutputPinValue("L", "x", 0.2);
+  outletPressure->SetOutputPinValue("V", "P", 0.8);
+  outletPressure->SetCalculationMethod(
+      MakeRef<Evaporator::MethodGivenOutletPressure>(outletPressure));
+
+  for (CalculationBlock *block : {inletData.get(), outletPressure.get()}) {
+    std::string name =
+        "evaporator/" + block->GetCalculationMethod()->GetName() + "/";
+    // Warm: repeated calls on unchanged inputs start from the last solution
+    suite.Add(name + "warm", Steam::UseIF97, [block](uint64_t n) {
+      for (uint64_t i = 0; i < n; ++i) {
+        block->Calculate();
+      }
+    });
+    suite.Add(name + "cold", Steam::UseIF97, [block](uint64_t n) {
+      for (uint64_t i = 0; i < n; ++i) {
+        block->GetCalculationMethod()->ResetWarmStart();
+        block->Calculate();
+      }
+    });
+  }
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  Bench::Options options;
+  try {
+    options = Bench::ParseArguments(argc, argv);
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "%s\n", e.what());
+    return 2;
+  }
+
+  Bench::Suite suite;
+  AddRefBenchmarks(suite);
+  AddPinBenchmarks(suite);
+  AddConnectorBenchmarks(suite);
+  AddNewtonBenchmarks(suite);
+  AddLinearBenchmarks(suite);
+  AddBlackLiquorBenchmarks(suite);
+  AddSteamBenchmarks(suite, "if97", Steam::UseIF97);
+  AddSteamBenchmarks(suite, "tables", [] {
+    static Ref<SteamTables> tables = SteamTables::Build();
+    Steam::UseTables(tables);
+  });
+  AddEvaporatorBenchmarks(suite);
+
+  std::vector<Bench::Result> results = suite.Run(options);
+  Steam::UseIF97();
+
+  if (!options.jsonPath.empty()) {
+    std::ofstream out(options.jsonPath);
+    Bench::WriteJson(out, results);
+    if (!out) {
+      std::fprintf(stderr, "Could not write %s\n", options.jsonPath.c_str());
+      return 1;
+    }
+  }
+  return 0;
+}
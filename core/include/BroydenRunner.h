@@ -0,0 +1,31 @@
+#pragma once
+#include "TearStreamRunner.h"
+#include <cstddef>
+#include <string>
+
+// Converges each recycle loop as one fixed-point problem x = g(x) over the
+// whole tear vector using Broyden's quasi-Newton method. The inverse
+// Jacobian of F(x) = g(x) - x starts as -I (direct substitution) and is
+// corrected by rank-one updates, so coupling between tear variables is
+// picked up as the iteration proceeds.
+class BroydenRunner : public TearStreamRunner {
+public:
+  struct Options {
+    size_t maxUpdates = 20;       // Rank limit before the approximation restarts
+    double maxRelativeStep = 0.5; // Largest step relative to a variable's scale
+    double divergenceRatio = 2.0; // Residual growth that resets the updates
+  };
+
+private:
+  Options options;
+
+protected:
+  inline std::string GetName() const override { return "Broyden"; }
+
+public:
+  BroydenRunner() = default;
+  explicit BroydenRunner(const Options &options);
+
+  void ConvergeComponent(const FlowsheetGraph &graph,
+                         const FlowsheetComponent &component) override;
+};
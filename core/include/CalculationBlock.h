@@ -1,10 +1,18 @@
 #pragma once
 #include "CalculationMethod.h"
+#include "FlowsheetArena.h"
 #include "Pin.h"
 #include "Ref.h"
+#include "StreamSchema.h"
+#include <iostream>
+#include <memory_resource>
 #include <string>
+#include <unordered_map>
 
 using PinRefMap = std::unordered_map<std::string, Ref<Pin>>;
+// The blocks' own pin maps, in the flowsheet arena of a block built with
+// FlowsheetArena::Make
+using ArenaPinRefMap = std::pmr::unordered_map<std::string, Ref<Pin>>;
 using ParamsMap = std::unordered_map<std::string, double>;
 
 class CalculationMethod;
@@ -12,17 +20,19 @@ class CalculationMethod;
 class CalculationBlock {
 protected:
   std::string id;
-  PinRefMap inputPins;
-  PinRefMap outputPins;
+  ArenaPinRefMap inputPins;
+  ArenaPinRefMap outputPins;
   ParamsMap params;
   Ref<CalculationMethod> method;
 
-  inline Ref<Pin> &AddInputPin(const std::string &name) {
-    this->inputPins[name] = Ref<Pin>(new Pin(name));
+  inline Ref<Pin> &AddInputPin(const std::string &name,
+                               const StreamSchema &schema) {
+    this->inputPins[name] = FlowsheetArena::MakeInCurrent<Pin>(name, schema);
     return this->inputPins[name];
   }
-  inline Ref<Pin> &AddOutputPin(const std::string &name) {
-    this->outputPins[name] = Ref<Pin>(new Pin(name));
+  inline Ref<Pin> &AddOutputPin(const std::string &name,
+                                const StreamSchema &schema) {
+    this->outputPins[name] = FlowsheetArena::MakeInCurrent<Pin>(name, schema);
     return this->outputPins[name];
   }
 
@@ -69,6 +79,11 @@ public:
   inline void SetCalculationMethod(const Ref<CalculationMethod> &method) {
     this->method = method;
   }
+  inline const Ref<CalculationMethod> &GetCalculationMethod() const {
+    return this->method;
+  }
 
-  void PrintAllValues() const;
+  // Report of the parameters and pin values, for the caller to print (not
+  // routed through the log)
+  void PrintAllValues(std::ostream &out = std::cout) const;
 };
@@ -1,20 +1,51 @@
 #pragma once
 #include "Ref.h"
 #include <string>
+#include <vector>
 
 class CalculationBlock;
 
 class CalculationMethod {
 protected:
   std::string name;
-  Ref<CalculationBlock> parent;
+  // The block owns its method, so the link back must not own the block
+  WeakRef<CalculationBlock> parent;
+
+  // The parent as the block class the method is written for. The method's
+  // constructor must have checked that it is one.
+  template <typename Block> inline Block &ParentAs() const {
+    return static_cast<Block &>(*parent);
+  }
 
 public:
   CalculationMethod() = default;
   CalculationMethod(const Ref<CalculationBlock> &parent);
   CalculationMethod(const Ref<CalculationBlock> &parent,
                     const std::string &name);
+  virtual ~CalculationMethod() = default;
   virtual void Calculate();
 
   inline std::string GetName() { return name; }
+
+  // Makes the next Calculate() start from its default initial guess
+  // instead of the previous solution (for methods that keep one)
+  virtual void ResetWarmStart() {}
+
+  // True for an input pin the method writes results to (e.g. a steam flow
+  // it solves for). FlowsheetGraph does not link such a pin to the pin
+  // upstream, so writing it never changes the upstream block's outlet.
+  virtual bool WritesInput(const std::string &) const { return false; }
+
+  // Equation-oriented interface. A method that supports it names the
+  // variables it solves for (pin slots or parameters of its block) and
+  // evaluates one residual per variable from the current values, so the
+  // block can take part in a global Newton solve of the whole flowsheet.
+  virtual bool SupportsEquationOriented() const { return false; }
+  // Appends pointers to the variables this method solves for
+  virtual void GetUnknowns(std::vector<double *> &unknowns);
+  // Writes one residual per unknown, in the same order
+  virtual void EvaluateResiduals(double *residuals);
+  // Refreshes values that are not unknowns (e.g. reported parameters) once
+  // the global solve has converged
+  virtual void UpdateDerivedValues();
 };
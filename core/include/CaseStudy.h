@@ -0,0 +1,90 @@
+#pragma once
+#include "Ref.h"
+#include "Runner.h"
+#include "Simulator.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Runs one flowsheet for many operating points in parallel. Every worker
+// builds its own instance of the flowsheet from the factory (with its own
+// runner and solver state), so the factory must not share blocks or
+// connectors between the flowsheets it returns. The flowsheet and runner
+// factories are called from the worker threads, one call at a time.
+//
+// Cases are ordered so that each one follows a nearby case, and every
+// worker solves a contiguous run of that order. Block methods and tear
+// streams therefore warm-start from the nearest case solved before. Results
+// can differ from a cold-started run within the solver tolerances.
+class CaseStudy {
+public:
+  using FlowsheetFactory = std::function<Flowsheet()>;
+  using RunnerFactory = std::function<Ref<Runner>()>;
+
+  // Value of a flowsheet, addressed by block ID
+  struct Variable {
+    enum Kind { Parameter, InputPin, OutputPin };
+    Kind kind;
+    std::string blockId;
+    std::string pin; // Unused for parameters
+    std::string name;
+
+    static Variable Param(const std::string &blockId, const std::string &name);
+    static Variable Input(const std::string &blockId, const std::string &pin,
+                          const std::string &name);
+    static Variable Output(const std::string &blockId, const std::string &pin,
+                           const std::string &name);
+    std::string Label() const;
+  };
+
+  // One row per case, one column per result variable
+  struct Results {
+    size_t caseCount = 0;
+    size_t columnCount = 0;
+    std::vector<double> values;       // Row-major, NaN for failed cases
+    std::vector<uint8_t> succeeded;   // Per case
+    std::vector<std::string> errors;  // Per case, empty if it succeeded
+    std::vector<std::string> columns; // Result labels
+
+    inline double Get(size_t caseIndex, size_t column) const {
+      return values[caseIndex * columnCount + column];
+    }
+    size_t FailureCount() const;
+    void WriteCsv(std::ostream &out) const;
+  };
+
+private:
+  struct Worker;
+
+  FlowsheetFactory factory;
+  RunnerFactory runnerFactory;
+  std::vector<Variable> inputs;
+  std::vector<Variable> results;
+  std::vector<double> cases; // Row-major, one value per input
+
+  std::vector<size_t> NearestNeighbourOrder() const;
+
+public:
+  // Uses WegsteinRunner for every case
+  explicit CaseStudy(const FlowsheetFactory &factory);
+  CaseStudy(const FlowsheetFactory &factory,
+            const RunnerFactory &runnerFactory);
+
+  // Input columns are set on the flowsheet before each case; result
+  // columns are read after it. Both return the column index. An input
+  // pin fed by a connector fails every case with std::invalid_argument.
+  size_t AddInput(const Variable &variable);
+  size_t AddResult(const Variable &variable);
+
+  // One value per input column, in AddInput() order
+  void AddCase(const std::vector<double> &values);
+  inline size_t CaseCount() const {
+    return inputs.empty() ? 0 : cases.size() / inputs.size();
+  }
+
+  // Zero threads means one per hardware thread
+  Results Run(size_t threadCount = 0) const;
+};
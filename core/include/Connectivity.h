@@ -1,6 +1,7 @@
 #pragma once
 #include "CalculationBlock.h"
 #include "Connector.h"
+#include "FlowsheetGraph.h"
 #include "Ref.h"
 #include <vector>
 
@@ -16,3 +17,11 @@ GetBlockConnectors(const std::vector<Ref<Connector>> &connectors,
 void PushDataAcrossConnectors(const std::vector<Ref<CalculationBlock>> &blocks,
                               const std::vector<Ref<Connector>> &connectors,
                               const Ref<CalculationBlock> &block);
+
+// Same as above, but walks the pre-resolved adjacency of a compiled graph
+void PushDataAcrossConnectors(const FlowsheetGraph &graph, BlockHandle block);
+
+// Skips the connectors flagged in `torn`, whose targets hold guesses owned
+// by a convergence algorithm
+void PushDataAcrossConnectors(const FlowsheetGraph &graph, BlockHandle block,
+                              const std::vector<bool> &torn);
@@ -0,0 +1,169 @@
+#pragma once
+#include <array>
+#include <cmath>
+#include <cstddef>
+
+// Forward-mode automatic differentiation over N independent variables.
+// Arithmetic on Dual<N> carries the gradient with respect to all N variables
+// alongside the value, so one evaluation of a residual yields a full
+// Jacobian row. Functions written as templates over the number type can be
+// instantiated on both double and Dual<N>.
+template <size_t N> struct Dual {
+  double value;
+  std::array<double, N> gradient;
+
+  // Constant: zero gradient
+  Dual(double value = 0.0) : value(value) { gradient.fill(0.0); }
+  Dual(double value, const std::array<double, N> &gradient)
+      : value(value), gradient(gradient) {}
+
+  // Independent variable number `index`
+  static Dual Variable(double value, size_t index) {
+    Dual result(value);
+    result.gradient[index] = 1.0;
+    return result;
+  }
+
+  // f(x) for a scalar function with known value and derivative at x.value
+  static Dual Chain(double value, double derivative, const Dual &x) {
+    Dual result(value);
+    for (size_t i = 0; i < N; ++i) {
+      result.gradient[i] = derivative * x.gradient[i];
+    }
+    return result;
+  }
+
+  // f(x, y) with known partial derivatives
+  static Dual Chain(double value, double dfdx, const Dual &x, double dfdy,
+                    const Dual &y) {
+    Dual result(value);
+    for (size_t i = 0; i < N; ++i) {
+      result.gradient[i] = dfdx * x.gradient[i] + dfdy * y.gradient[i];
+    }
+    return result;
+  }
+
+  // True if the value does not depend on any variable
+  bool IsConstant() const {
+    for (double d : gradient) {
+      if (d != 0.0) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  Dual &operator+=(const Dual &other) {
+    value += other.value;
+    for (size_t i = 0; i < N; ++i) {
+      gradient[i] += other.gradient[i];
+    }
+    return *this;
+  }
+  Dual &operator-=(const Dual &other) {
+    value -= other.value;
+    for (size_t i = 0; i < N; ++i) {
+      gradient[i] -= other.gradient[i];
+    }
+    return *this;
+  }
+  Dual &operator*=(const Dual &other) {
+    for (size_t i = 0; i < N; ++i) {
+      gradient[i] = gradient[i] * other.value + value * other.gradient[i];
+    }
+    value *= other.value;
+    return *this;
+  }
+  Dual &operator/=(const Dual &other) {
+    double inverse = 1.0 / other.value;
+    value *= inverse;
+    for (size_t i = 0; i < N; ++i) {
+      gradient[i] = (gradient[i] - value * other.gradient[i]) * inverse;
+    }
+    return *this;
+  }
+};
+
+template <size_t N> Dual<N> operator-(const Dual<N> &x) {
+  Dual<N> result(-x.value);
+  for (size_t i = 0; i < N; ++i) {
+    result.gradient[i] = -x.gradient[i];
+  }
+  return result;
+}
+
+// Binary operators for Dual op Dual, Dual op double and double op Dual
+#define DUAL_BINARY_OPERATOR(op)                                               \
+  template <size_t N>                                                          \
+  Dual<N> operator op(Dual<N> lhs, const Dual<N> &rhs) {                       \
+    return lhs op## = rhs;                                                     \
+  }                                                                            \
+  template <size_t N> Dual<N> operator op(Dual<N> lhs, double rhs) {           \
+    return lhs op## = Dual<N>(rhs);                                            \
+  }                                                                            \
+  template <size_t N> Dual<N> operator op(double lhs, const Dual<N> &rhs) {    \
+    return Dual<N>(lhs) op## = rhs;                                            \
+  }
+DUAL_BINARY_OPERATOR(+)
+DUAL_BINARY_OPERATOR(-)
+DUAL_BINARY_OPERATOR(*)
+DUAL_BINARY_OPERATOR(/)
+#undef DUAL_BINARY_OPERATOR
+
+// Comparisons look at the value only
+#define DUAL_COMPARISON(op)                                                    \
+  template <size_t N> bool operator op(const Dual<N> &lhs, const Dual<N> &rhs) { \
+    return lhs.value op rhs.value;                                             \
+  }                                                                            \
+  template <size_t N> bool operator op(const Dual<N> &lhs, double rhs) {       \
+    return lhs.value op rhs;                                                   \
+  }                                                                            \
+  template <size_t N> bool operator op(double lhs, const Dual<N> &rhs) {       \
+    return lhs op rhs.value;                                                   \
+  }
+DUAL_COMPARISON(<)
+DUAL_COMPARISON(>)
+DUAL_COMPARISON(<=)
+DUAL_COMPARISON(>=)
+#undef DUAL_COMPARISON
+
+// Math functions, found by argument-dependent lookup next to the std
+// versions (`using std::exp; exp(x)` works for both number types)
+template <size_t N> Dual<N> exp(const Dual<N> &x) {
+  double e = std::exp(x.value);
+  return Dual<N>::Chain(e, e, x);
+}
+template <size_t N> Dual<N> log(const Dual<N> &x) {
+  return Dual<N>::Chain(std::log(x.value), 1.0 / x.value, x);
+}
+template <size_t N> Dual<N> log10(const Dual<N> &x) {
+  return Dual<N>::Chain(std::log10(x.value), 1.0 / (x.value * std::log(10.0)),
+                        x);
+}
+template <size_t N> Dual<N> sqrt(const Dual<N> &x) {
+  double s = std::sqrt(x.value);
+  return Dual<N>::Chain(s, 0.5 / s, x);
+}
+template <size_t N> Dual<N> abs(const Dual<N> &x) {
+  return x.value < 0.0 ? -x : x;
+}
+template <size_t N> Dual<N> pow(const Dual<N> &x, double exponent) {
+  double p = std::pow(x.value, exponent - 1.0);
+  if (x.value == 0.0) {
+    // p is infinite for exponent < 1, and inf * 0 is NaN: the value is
+    // taken directly, and the slope only reaches the variables x depends on
+    Dual<N> result(std::pow(0.0, exponent));
+    double derivative = exponent == 0.0 ? 0.0 : exponent * p;
+    for (size_t i = 0; i < N; ++i) {
+      if (x.gradient[i] != 0.0) {
+        result.gradient[i] = derivative * x.gradient[i];
+      }
+    }
+    return result;
+  }
+  return Dual<N>::Chain(p * x.value, exponent * p, x);
+}
+
+// Value of a double or Dual, for code templated over the number type
+inline double ValueOf(double x) { return x; }
+template <size_t N> double ValueOf(const Dual<N> &x) { return x.value; }
@@ -0,0 +1,33 @@
+#pragma once
+#include "FlowsheetGraph.h"
+#include "Ref.h"
+#include "Runner.h"
+
+// Solves the whole flowsheet as one nonlinear system. Every block
+// contributes its method's residuals, every connector contributes equality
+// equations between the variables it links, and the assembled sparse system
+// is solved with a single damped Newton iteration. A sequential-modular
+// runner provides the initial point. Run() throws std::logic_error before
+// calculating anything if a block's method does not support
+// equation-oriented mode.
+class EquationOrientedRunner : public Runner {
+public:
+  struct Options {
+    double tolerance = 1e-8;         // Max-norm of the residual vector
+    int maxIterations = 50;          // Newton iterations
+    double relativePerturbation = 1e-7; // Finite-difference step
+  };
+
+private:
+  Ref<Runner> initializer;
+  Options options;
+
+public:
+  // Initializes with WegsteinRunner
+  EquationOrientedRunner();
+  explicit EquationOrientedRunner(const Ref<Runner> &initializer);
+  EquationOrientedRunner(const Ref<Runner> &initializer,
+                         const Options &options);
+
+  void Run(const FlowsheetGraph &graph) override;
+};
@@ -0,0 +1,106 @@
+#pragma once
+#include "Ref.h"
+#include <atomic>
+#include <cstddef>
+#include <memory_resource>
+#include <vector>
+
+// Monotonic memory for the objects of one flowsheet. Blocks, methods and
+// connectors made with Make(), the pins a block adds while it is being
+// constructed and the blocks' pin maps are placed one after another in
+// large chunks, in the order they are built. Releasing an object runs its
+// destructor but returns no memory; Reset() or the destructor frees all of
+// it at once.
+//
+//   Ref<FlowsheetArena> arena = FlowsheetArena::Create();
+//   Ref<CalculationBlock> e1 = arena->Make<Evaporator>("E1", params);
+//   e1->SetCalculationMethod(
+//       arena->Make<Evaporator::MethodGivenInletData>(e1));
+//
+// Objects built in an arena made by Create() hold a reference to it, so it
+// outlives them. An arena constructed directly must outlive its objects
+// itself; if it does not, its destructor reports the leak and keeps the
+// chunks. Building is not thread-safe; releasing objects from other
+// threads is.
+class FlowsheetArena : public std::pmr::memory_resource {
+private:
+  struct Chunk {
+    unsigned char *data;
+    size_t size;
+  };
+
+  size_t chunkSize;
+  std::vector<Chunk> chunks;
+  unsigned char *next = nullptr; // Free space of the last chunk
+  unsigned char *end = nullptr;
+  size_t bytesAllocated = 0; // Including alignment padding
+  std::atomic<size_t> liveAllocations{0};
+
+  WeakRef<FlowsheetArena> self; // Set by Create()
+
+  static thread_local FlowsheetArena *current;
+
+  void AddChunk(size_t minimumSize);
+
+protected:
+  void *do_allocate(size_t bytes, size_t alignment) override;
+  void do_deallocate(void *, size_t, size_t) override;
+  bool do_is_equal(const std::pmr::memory_resource &other) const
+      noexcept override {
+    return this == &other;
+  }
+
+public:
+  // Makes the arena the current one of this thread for its lifetime
+  class Scope {
+  private:
+    FlowsheetArena *previous;
+
+  public:
+    explicit Scope(FlowsheetArena *arena) : previous(current) {
+      current = arena;
+    }
+    ~Scope() { current = previous; }
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+  };
+
+  explicit FlowsheetArena(size_t chunkSize = 64 * 1024);
+  ~FlowsheetArena() override;
+  FlowsheetArena(const FlowsheetArena &) = delete;
+  FlowsheetArena &operator=(const FlowsheetArena &) = delete;
+
+  static Ref<FlowsheetArena> Create(size_t chunkSize = 64 * 1024);
+
+  // Constructs a T in the arena. Objects the constructor creates with
+  // MakeInCurrent (a block's pins) are placed in the arena too.
+  template <typename T, typename... Args> Ref<T> Make(Args &&...args) {
+    Scope scope(this);
+    if (Ref<FlowsheetArena> owner = this->self.Lock()) {
+      return AllocateRef<T>(owner, std::forward<Args>(args)...);
+    }
+    return AllocateRef<T>(*this, std::forward<Args>(args)...);
+  }
+
+  // In the arena of the innermost Make() or Scope on this thread, or on the
+  // heap if there is none
+  template <typename T, typename... Args>
+  static Ref<T> MakeInCurrent(Args &&...args) {
+    if (current) {
+      return current->Make<T>(std::forward<Args>(args)...);
+    }
+    return MakeRef<T>(std::forward<Args>(args)...);
+  }
+
+  // For containers of objects built in the arena
+  static std::pmr::memory_resource *CurrentResource();
+
+  // Frees every chunk but the first, which is reused. Throws
+  // std::logic_error while objects in the arena are still referenced.
+  void Reset();
+
+  inline size_t BytesAllocated() const { return bytesAllocated; }
+  inline size_t LiveAllocations() const {
+    return liveAllocations.load(std::memory_order_relaxed);
+  }
+};
@@ -0,0 +1,114 @@
+#pragma once
+#include "CalculationBlock.h"
+#include "Connector.h"
+#include "Pin.h"
+#include "Ref.h"
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Integer handle of a block inside a compiled FlowsheetGraph
+using BlockHandle = size_t;
+
+// Connector with both endpoints resolved at compile time
+struct CompiledConnector {
+  Ref<Connector> connector;
+  BlockHandle origin;
+  BlockHandle target;
+  Pin *originPin;
+  Pin *targetPin; // Linked to originPin unless copied (see FlowsheetGraph)
+  bool tear;
+  // Target slot of each origin slot (npos if the target lacks the variable).
+  // Left empty when both pins share a schema and slots map one to one.
+  std::vector<size_t> targetSlots;
+};
+
+// Strongly connected component of the block graph
+struct FlowsheetComponent {
+  std::vector<BlockHandle> blocks; // Ascending handle order
+  std::vector<size_t> connectors;  // Connectors with both ends inside
+  bool cyclic;                     // Contains at least one recycle loop
+};
+
+// Contiguous view over a slice of an index array
+class IndexRange {
+private:
+  const size_t *first;
+  const size_t *last;
+
+public:
+  IndexRange(const size_t *first, const size_t *last)
+      : first(first), last(last) {}
+  inline const size_t *begin() const { return first; }
+  inline const size_t *end() const { return last; }
+  inline size_t size() const { return last - first; }
+  inline bool empty() const { return first == last; }
+};
+
+// Indexed form of a flowsheet. Block IDs and pin names are resolved once
+// here, so runners can walk the graph by integer handles only.
+//
+// While the graph exists, the target pin of each connector that is not
+// marked as a tear stream is linked to its origin pin: both read and write
+// one stream, and pushing data across the connector is a no-op. Tear
+// targets, targets whose schema differs from the origin's and targets the
+// block's method writes (CalculationMethod::WritesInput) keep their own
+// values and are pushed by copy. The destructor unlinks the pins again,
+// leaving each with the values it last saw.
+class FlowsheetGraph {
+private:
+  std::vector<Ref<CalculationBlock>> blocks;
+  std::vector<CompiledConnector> connectors;
+  std::unordered_map<std::string, BlockHandle> handles;
+  std::vector<Pin *> linkedPins;
+
+  // Adjacency in CSR form: the connectors leaving block b are
+  // outEdges[outOffsets[b]] .. outEdges[outOffsets[b + 1] - 1]
+  std::vector<size_t> outOffsets;
+  std::vector<size_t> outEdges;
+  std::vector<size_t> inOffsets;
+  std::vector<size_t> inEdges;
+
+public:
+  FlowsheetGraph(const std::vector<Ref<CalculationBlock>> &blocks,
+                 const std::vector<Ref<Connector>> &connectors);
+  ~FlowsheetGraph();
+  FlowsheetGraph(const FlowsheetGraph &) = delete;
+  FlowsheetGraph &operator=(const FlowsheetGraph &) = delete;
+
+  inline size_t BlockCount() const { return blocks.size(); }
+  inline size_t ConnectorCount() const { return connectors.size(); }
+
+  inline CalculationBlock &GetBlock(BlockHandle block) const {
+    return *blocks[block];
+  }
+  inline const Ref<CalculationBlock> &GetBlockRef(BlockHandle block) const {
+    return blocks[block];
+  }
+  inline const CompiledConnector &GetConnector(size_t index) const {
+    return connectors[index];
+  }
+
+  // Indices of the connectors leaving/entering a block
+  inline IndexRange OutConnectors(BlockHandle block) const {
+    return IndexRange(outEdges.data() + outOffsets[block],
+                      outEdges.data() + outOffsets[block + 1]);
+  }
+  inline IndexRange InConnectors(BlockHandle block) const {
+    return IndexRange(inEdges.data() + inOffsets[block],
+                      inEdges.data() + inOffsets[block + 1]);
+  }
+
+  // Throws std::out_of_range if no block has this ID
+  BlockHandle FindBlock(const std::string &blockId) const;
+
+  // Splits the graph into strongly connected components, returned in
+  // topological order (every component comes after the ones feeding it)
+  std::vector<FlowsheetComponent> Partition() const;
+
+  // Calculation order of a component's blocks once the connectors flagged in
+  // `torn` are cut. Blocks still on an uncut cycle keep ascending order.
+  std::vector<BlockHandle> OrderBlocks(const FlowsheetComponent &component,
+                                       const std::vector<bool> &torn) const;
+};
@@ -4,6 +4,5 @@
 
 class LinearRunner : public Runner {
 public:
-  void Run(const std::vector<Ref<CalculationBlock>> &blocks,
-           const std::vector<Ref<Connector>> &connectors);
+  void Run(const FlowsheetGraph &graph) override;
 };
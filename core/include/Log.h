@@ -0,0 +1,88 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <sstream>
+#include <string>
+
+// Leveled, asynchronous logging for all progress and diagnostic output.
+//
+//   SIM_LOG(Info) << "Converged after " << iterations << " iterations";
+//
+// A statement below the runtime level (Log::SetLevel, Info by default)
+// costs one branch and its operands are not evaluated; below the level
+// compiled in (SIM_LOG_COMPILED_LEVEL, set with the SIM_LOG_LEVEL CMake
+// cache variable) it is removed entirely.
+//
+// Each thread appends records to its own lock-free ring buffer, and a
+// background thread writes them to the sink in time order. A thread whose
+// buffer is full writes out the pending records itself instead of waiting.
+// Call Log::Flush() before writing to the same stream directly;
+// Simulator::Run does so when it returns.
+enum class LogLevel { Trace, Debug, Info, Warning, Error, Off };
+
+#ifndef SIM_LOG_COMPILED_LEVEL
+#define SIM_LOG_COMPILED_LEVEL Trace
+#endif
+
+#define SIM_LOG(level)                                                        \
+  if (!Log::IsEnabled(LogLevel::level)) {                                     \
+  } else                                                                      \
+    Log::Line(LogLevel::level).Stream()
+
+namespace Log {
+
+constexpr LogLevel CompiledLevel = LogLevel::SIM_LOG_COMPILED_LEVEL;
+
+struct Record {
+  LogLevel level;
+  uint32_t thread; // Small sequential ID
+  uint64_t time;   // ns since the first record
+  std::string text;
+};
+
+using Sink = std::function<void(const Record &record)>;
+
+extern std::atomic<LogLevel> runtimeLevel;
+
+inline bool IsEnabled(LogLevel level) {
+  return level >= CompiledLevel &&
+         level >= runtimeLevel.load(std::memory_order_relaxed);
+}
+
+inline void SetLevel(LogLevel level) {
+  runtimeLevel.store(level, std::memory_order_relaxed);
+}
+inline LogLevel GetLevel() {
+  return runtimeLevel.load(std::memory_order_relaxed);
+}
+
+const char *LevelName(LogLevel level);
+// Throws std::invalid_argument for an unknown name
+LogLevel ParseLevel(const std::string &name);
+
+// Replaces the default sink, which writes the text of Info and lower
+// records to std::cout and of warnings and errors, prefixed with the
+// level, to std::cerr. Pending records are written to the old sink first.
+void SetSink(Sink sink);
+void ResetSink();
+
+// Writes every record logged so far, by any thread, before returning
+void Flush();
+
+// One log statement; the record is queued when it goes out of scope
+class Line {
+private:
+  LogLevel level;
+  std::ostringstream stream;
+
+public:
+  explicit Line(LogLevel level) : level(level) {}
+  ~Line();
+  Line(const Line &) = delete;
+  Line &operator=(const Line &) = delete;
+
+  inline std::ostream &Stream() { return stream; }
+};
+
+} // namespace Log
@@ -1,7 +1,34 @@
 #pragma once
+#include "Log.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
 #include <functional>
+#include <iomanip>
+#include <limits>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
+// Why a Newton solve stopped
+enum class SolverStatus {
+  Converged,
+  MaxIterations,    // Iteration limit reached
+  SingularJacobian, // Newton step could not be computed
+  NonFinite,        // Residual is NaN or infinite at the initial point or
+                    // after a full step without line search
+  LineSearchFailed, // No step length reduced the residual
+  Diverged          // Residual grew past divergence_limit times its start
+};
+
+const char *to_string(SolverStatus status);
+
+// Both Newton solvers globalize the Newton step with a backtracking line
+// search: the step is halved until the residual norm decreases
+// sufficiently, so steps into NaN regions or overshoots are cut back
+// instead of taken. Unknowns are kept within optional bounds by projecting
+// every trial point onto them.
 class NDNewtonRaphson {
 public:
   // Type definitions for cleaner code
@@ -15,6 +42,14 @@ public:
     int max_iterations = 100; // Maximum number of iterations
     double h = 1e-8;          // Step size for numerical differentiation
     bool verbose = false;     // Print iteration details
+    bool line_search = true;  // Backtrack on steps that do not reduce ||f||
+    int max_backtracks = 20;  // Step halvings per iteration
+    double divergence_limit = 1e8; // Stop when ||f|| grows by this factor
+    // When no step length reduces ||f|| any more, a Newton step below
+    // step_tolerance (relative to x) with ||f|| below stall_factor times
+    // tolerance means ||f|| is at its round-off level: converged
+    double step_tolerance = 1e-12;
+    double stall_factor = 100.0;
   };
 
   struct SolverResult {
@@ -22,6 +57,7 @@ public:
     int iterations;
     double residual_norm;
     bool converged;
+    SolverStatus status;
   };
 
 private:
@@ -29,13 +65,15 @@ private:
   JacobianFunction jacobian_;
   SolverOptions options_;
   bool use_analytical_jacobian_;
+  std::vector<double> lower_; // Empty when unbounded
+  std::vector<double> upper_;
 
   // Private helper methods
   std::vector<std::vector<double>>
   numerical_jacobian(const std::vector<double> &x);
-  std::vector<double> solve_linear_system(std::vector<std::vector<double>> A,
-                                          std::vector<double> b);
   double vector_norm(const std::vector<double> &v);
+  bool is_negligible(const std::vector<double> &step,
+                     const std::vector<double> &x) const;
   std::vector<double> vector_subtract(const std::vector<double> &a,
                                       const std::vector<double> &b);
 
@@ -50,6 +88,18 @@ public:
   // Main solver function
   SolverResult solve(const std::vector<double> &initial_guess);
 
+  // Solves A * x = b by Gaussian elimination with partial pivoting. Throws
+  // std::runtime_error on a singular matrix.
+  static std::vector<double>
+  solve_linear_system(std::vector<std::vector<double>> A,
+                      std::vector<double> b);
+
+  // Per-variable bounds on the unknowns; empty vectors remove them. Throws
+  // std::invalid_argument if the sizes differ, and solve() does if they do
+  // not match the initial guess.
+  void set_bounds(const std::vector<double> &lower,
+                  const std::vector<double> &upper);
+
   // Utility methods
   void set_jacobian(JacobianFunction jacobian);
   void use_numerical_jacobian();
@@ -57,3 +107,257 @@ public:
   bool is_using_analytical_jacobian() const;
   void set_options(const SolverOptions &options);
 };
+
+// Newton-Raphson for small systems whose size is known at compile time.
+// Same algorithm as NDNewtonRaphson, but all storage lives on the stack and
+// the residual is any callable `void(const Vector &x, Vector &out)`, so a
+// solve performs no heap allocations. A callable that also takes a
+// `Matrix &J` fills in the Jacobian itself (e.g. evaluated on Dual<N>) and
+// skips the finite differences.
+template <size_t N> class FixedNewton {
+public:
+  using Vector = std::array<double, N>;
+  using Matrix = std::array<Vector, N>;
+  using SolverOptions = NDNewtonRaphson::SolverOptions;
+
+  struct SolverResult {
+    int iterations;
+    double residual_norm;
+    bool converged;
+    SolverStatus status;
+  };
+
+private:
+  SolverOptions options_;
+  Vector lower_;
+  Vector upper_;
+
+  template <typename Residual>
+  static constexpr bool provides_jacobian =
+      std::is_invocable_v<Residual &, const Vector &, Vector &, Matrix &>;
+
+  // Residual at x, plus the Jacobian if the callable provides it
+  template <typename Residual>
+  static void evaluate(Residual &f, const Vector &x, Vector &f_x, Matrix &J) {
+    if constexpr (provides_jacobian<Residual>) {
+      f(x, f_x, J);
+    } else {
+      f(x, f_x);
+    }
+  }
+
+  template <typename Residual>
+  void numerical_jacobian(Residual &f, Vector &x, const Vector &f_x,
+                          Matrix &J) const {
+    Vector f_x_plus_h;
+    for (size_t j = 0; j < N; ++j) {
+      double saved = x[j];
+      x[j] = saved + options_.h;
+      f(static_cast<const Vector &>(x), f_x_plus_h);
+      x[j] = saved;
+
+      for (size_t i = 0; i < N; ++i) {
+        J[i][j] = (f_x_plus_h[i] - f_x[i]) / options_.h;
+      }
+    }
+  }
+
+  static double vector_norm(const Vector &v) {
+    double sum = 0.0;
+    for (double val : v) {
+      sum += val * val;
+    }
+    return std::sqrt(sum);
+  }
+
+  bool is_negligible(const Vector &step, const Vector &x) const {
+    for (size_t i = 0; i < N; ++i) {
+      if (!(std::abs(step[i]) <=
+            options_.step_tolerance * std::max(std::abs(x[i]), 1.0))) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void project(Vector &x) const {
+    for (size_t i = 0; i < N; ++i) {
+      x[i] = std::min(std::max(x[i], lower_[i]), upper_[i]);
+    }
+  }
+
+public:
+  explicit FixedNewton(const SolverOptions &options) : options_(options) {
+    lower_.fill(-std::numeric_limits<double>::infinity());
+    upper_.fill(std::numeric_limits<double>::infinity());
+  }
+
+  void set_bounds(const Vector &lower, const Vector &upper) {
+    lower_ = lower;
+    upper_ = upper;
+  }
+
+  // Solves A * x = b in place (b receives x) by Gaussian elimination with
+  // partial pivoting. Returns false on a singular matrix.
+  static bool solve_linear_system(Matrix &A, Vector &b) {
+    for (size_t k = 0; k + 1 < N; ++k) {
+      size_t pivot_row = k;
+      for (size_t i = k + 1; i < N; ++i) {
+        if (std::abs(A[i][k]) > std::abs(A[pivot_row][k])) {
+          pivot_row = i;
+        }
+      }
+
+      if (pivot_row != k) {
+        std::swap(A[k], A[pivot_row]);
+        std::swap(b[k], b[pivot_row]);
+      }
+
+      if (std::abs(A[k][k]) < 1e-15) {
+        return false;
+      }
+
+      for (size_t i = k + 1; i < N; ++i) {
+        double factor = A[i][k] / A[k][k];
+        for (size_t j = k; j < N; ++j) {
+          A[i][j] -= factor * A[k][j];
+        }
+        b[i] -= factor * b[k];
+      }
+    }
+
+    for (size_t i = N; i-- > 0;) {
+      for (size_t j = i + 1; j < N; ++j) {
+        b[i] -= A[i][j] * b[j];
+      }
+      b[i] /= A[i][i];
+    }
+    return true;
+  }
+
+  // `x` holds the initial guess and receives the solution. The last call to
+  // `f` is always made at the returned point.
+  template <typename Residual> SolverResult solve(Residual &&f, Vector &x) {
+    SolverResult result = {0, 0.0, false, SolverStatus::MaxIterations};
+    Vector f_x, step, trial, f_trial;
+    Matrix J, J_trial;
+
+    if (options_.verbose) {
+      SIM_LOG(Info) << "Starting Newton-Raphson solver with " << N
+                    << " variables";
+    }
+
+    project(x);
+    evaluate(f, x, f_x, J);
+    result.residual_norm = vector_norm(f_x);
+    double initial_norm = result.residual_norm;
+    if (!std::isfinite(result.residual_norm)) {
+      result.status = SolverStatus::NonFinite;
+      return result;
+    }
+
+    for (int iter = 0;; ++iter) {
+      if (options_.verbose) {
+        SIM_LOG(Info) << "Iteration " << iter << ": ||f(x)|| = "
+                      << std::setprecision(10) << std::scientific
+                      << result.residual_norm;
+      }
+
+      if (result.residual_norm < options_.tolerance) {
+        result.converged = true;
+        result.status = SolverStatus::Converged;
+        result.iterations = iter;
+        if (options_.verbose) {
+          SIM_LOG(Info) << "Converged after " << iter << " iterations";
+        }
+        return result;
+      }
+      if (iter == options_.max_iterations) {
+        result.iterations = iter;
+        break;
+      }
+
+      if constexpr (!provides_jacobian<std::remove_reference_t<Residual>>) {
+        numerical_jacobian(f, x, f_x, J);
+      }
+
+      // Solve J * step = -f(x)
+      for (size_t i = 0; i < N; ++i) {
+        step[i] = -f_x[i];
+      }
+      if (!solve_linear_system(J, step)) {
+        result.status = SolverStatus::SingularJacobian;
+        result.iterations = iter;
+        break;
+      }
+
+      // Backtrack from the full step until ||f|| decreases sufficiently
+      double alpha = 1.0;
+      double trial_norm = 0.0;
+      bool accepted = false;
+      for (int backtrack = 0;; ++backtrack) {
+        for (size_t i = 0; i < N; ++i) {
+          trial[i] = x[i] + alpha * step[i];
+        }
+        project(trial);
+        evaluate(f, trial, f_trial, J_trial);
+        trial_norm = vector_norm(f_trial);
+
+        bool finite = std::isfinite(trial_norm);
+        if (finite && (!options_.line_search ||
+                       trial_norm <= (1.0 - 1e-4 * alpha) *
+                                         result.residual_norm)) {
+          accepted = true;
+          break;
+        }
+        if (!options_.line_search || backtrack == options_.max_backtracks) {
+          break;
+        }
+        alpha *= 0.5;
+      }
+
+      if (!accepted) {
+        result.status = std::isfinite(trial_norm)
+                            ? SolverStatus::LineSearchFailed
+                            : SolverStatus::NonFinite;
+        result.iterations = iter + 1;
+        if (result.status == SolverStatus::LineSearchFailed &&
+            result.residual_norm <=
+                options_.stall_factor * options_.tolerance &&
+            is_negligible(step, x)) {
+          result.converged = true;
+          result.status = SolverStatus::Converged;
+          result.iterations = iter;
+        }
+        break;
+      }
+
+      x = trial;
+      f_x = f_trial;
+      // Without an analytic Jacobian J_trial is never written, and J is
+      // rebuilt at the top of the next iteration
+      if constexpr (provides_jacobian<std::remove_reference_t<Residual>>) {
+        J = J_trial;
+      }
+      result.residual_norm = trial_norm;
+
+      if (result.residual_norm > options_.divergence_limit * initial_norm) {
+        result.status = SolverStatus::Diverged;
+        result.iterations = iter + 1;
+        break;
+      }
+    }
+
+    if (options_.verbose) {
+      SIM_LOG(Info) << "Stopped: " << to_string(result.status);
+    }
+
+    // Leave the callable's captured state at the returned point
+    evaluate(f, x, f_x, J);
+    result.residual_norm = vector_norm(f_x);
+    return result;
+  }
+
+  const SolverOptions &get_options() const { return options_; }
+  void set_options(const SolverOptions &options) { options_ = options; }
+};
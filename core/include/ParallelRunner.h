@@ -0,0 +1,25 @@
+#pragma once
+#include "FlowsheetGraph.h"
+#include "Ref.h"
+#include "Runner.h"
+#include "TearStreamRunner.h"
+#include "ThreadPool.h"
+#include <cstddef>
+
+// Runs independent parts of the flowsheet concurrently. The strongly
+// connected components form a DAG; a component is scheduled on the pool as
+// soon as every component feeding it has finished. Recycle loops are
+// converged inside their own task by a serial tear stream runner (Wegstein
+// by default), so results are identical to that runner's.
+class ParallelRunner : public Runner {
+private:
+  ThreadPool pool;
+  Ref<TearStreamRunner> converger;
+
+public:
+  // Zero threads means one per hardware thread
+  explicit ParallelRunner(size_t threadCount = 0);
+  ParallelRunner(size_t threadCount, const Ref<TearStreamRunner> &converger);
+
+  void Run(const FlowsheetGraph &graph) override;
+};
@@ -1,23 +1,57 @@
 #pragma once
+#include "StreamSchema.h"
+#include <cassert>
 #include <string>
-#include <unordered_map>
-
-using PinMap = std::unordered_map<std::string, double>;
 
 class Pin {
 private:
   std::string id;
-  PinMap values;
+  const StreamSchema *schema;
+  double *data; // `values`, or the stream of the pin this one is linked to
+  double values[StreamSchema::MaxVariables];
 
 public:
   Pin();
-  Pin(const std::string &id);
+  Pin(const std::string &id, const StreamSchema &schema);
+  // A copy holds its own values, even if `other` is linked
+  Pin(const Pin &other);
+  Pin &operator=(const Pin &other);
   inline std::string GetId() { return this->id; }
-  inline double GetValue(const std::string &variableName) {
-    return values[variableName];
+  inline const StreamSchema &GetSchema() const { return *this->schema; }
+  inline size_t Size() const { return this->schema->Size(); }
+
+  // Fast path: access by schema slot
+  inline double GetValue(size_t slot) const {
+    assert(slot < Size() && "Pin slot out of range");
+    return data[slot];
+  }
+  inline void SetValue(size_t slot, double value) {
+    assert(slot < Size() && "Pin slot out of range");
+    data[slot] = value;
+  }
+  inline double *Data() { return data; }
+  inline const double *Data() const { return data; }
+
+  // Slow path: access by variable name. Throws std::out_of_range if the
+  // variable is not part of the pin's schema.
+  inline double GetValue(const std::string &variableName) const {
+    return data[schema->GetSlot(variableName)];
   }
-  inline PinMap &GetValuesMap() { return values; }
   inline void SetValue(const std::string &variableName, double value) {
-    values[variableName] = value;
+    data[schema->GetSlot(variableName)] = value;
+  }
+
+  // Makes this (input) pin read and write the values of `source` in place,
+  // so that what the source's block writes needs no copy. Throws
+  // std::invalid_argument if the schemas differ.
+  void Link(Pin &source);
+  // Back to the pin's own storage, holding the linked stream's values
+  void Unlink();
+  inline bool IsLinked() const { return data != values; }
+  inline bool IsLinkedTo(const Pin &source) const {
+    return data == source.data;
   }
+
+  // Copies every variable of `from` that `to` also carries
+  static void CopyValues(const Pin &from, Pin &to);
 };
@@ -0,0 +1,92 @@
+#pragma once
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+// Instrumentation of the hot paths: block calculations, connector pushes,
+// Newton solves and the iterations of the runners. It is compiled in only
+// with SIM_ENABLE_PROFILING (cmake -DSIM_ENABLE_PROFILING=ON); otherwise
+// the macros below expand to nothing and their arguments are not
+// evaluated.
+//
+//   SIM_PROFILE_SCOPE(scope, "block", block.GetId());
+//   SIM_PROFILE(scope.SetIterations(iterations));
+//   SIM_PROFILE_COUNTER("wegstein", "tear residual", residual);
+//
+// Events are buffered per thread. Export or clear them only while no run is
+// in progress.
+#ifdef SIM_ENABLE_PROFILING
+#define SIM_PROFILE_SCOPE(scope, category, name)                              \
+  Profiler::Scope scope(category, name)
+#define SIM_PROFILE(statement) statement
+#define SIM_PROFILE_COUNTER(category, name, value)                            \
+  Profiler::RecordCounter(category, name, value)
+#else
+#define SIM_PROFILE_SCOPE(scope, category, name) ((void)0)
+#define SIM_PROFILE(statement) ((void)0)
+#define SIM_PROFILE_COUNTER(category, name, value) ((void)0)
+#endif
+
+namespace Profiler {
+
+constexpr bool Enabled =
+#ifdef SIM_ENABLE_PROFILING
+    true;
+#else
+    false;
+#endif
+
+struct Event {
+  const char *category;
+  std::string name;
+  char phase;      // 'X' for a scope, 'C' for a counter
+  uint32_t thread; // Small sequential ID
+  double start;    // µs since the first event
+  double duration; // µs
+  // Optional details, left at their defaults when not set
+  int iterations = -1;
+  int residualEvaluations = -1;
+  double value = 0.0;     // Residual of a scope, value of a counter
+  bool hasValue = false;
+  const char *status = nullptr;
+};
+
+// Records one event covering its lifetime. A scope left by an exception is
+// marked as failed unless a status was set.
+class Scope {
+private:
+  Event event;
+  int uncaughtExceptions;
+
+public:
+  Scope(const char *category, std::string name);
+  ~Scope();
+  Scope(const Scope &) = delete;
+  Scope &operator=(const Scope &) = delete;
+
+  inline void SetIterations(int iterations) {
+    event.iterations = iterations;
+  }
+  inline void SetResidualEvaluations(int count) {
+    event.residualEvaluations = count;
+  }
+  inline void SetResidual(double residual) {
+    event.value = residual;
+    event.hasValue = true;
+  }
+  inline void SetStatus(const char *status) { event.status = status; }
+};
+
+void RecordCounter(const char *category, const std::string &name,
+                   double value);
+
+// Time and work per category, and per block (its Calculate() time joined
+// with its Newton solves), the most expensive `maxBlocks` first
+void PrintSummary(std::ostream &out, size_t maxBlocks = 20);
+
+// Chrome trace-event JSON, for chrome://tracing or ui.perfetto.dev
+void WriteChromeTrace(std::ostream &out);
+
+void Clear();
+
+} // namespace Profiler
@@ -1,71 +1,285 @@
 #pragma once
+#include <atomic>
 #include <cassert>
+#include <cstddef>
+#include <memory_resource>
+#include <new>
+#include <type_traits>
 #include <utility>
 
-template <typename T> class Ref {
+// Reference counting policies. AtomicRefCount makes copying and releasing
+// Refs to the same object from several threads safe; LocalRefCount is a
+// plain integer for objects that stay on one thread. Ref<T> uses
+// DefaultRefCount, chosen with the SIM_ATOMIC_REFS CMake option.
+class LocalRefCount {
 private:
+  int count = 1;
+
+public:
+  inline void Increment() { ++count; }
+  // False, leaving the count at zero, if the last reference is gone
+  inline bool IncrementIfNonZero() {
+    if (count == 0) {
+      return false;
+    }
+    ++count;
+    return true;
+  }
+  // True when the last reference was released
+  inline bool Decrement() { return --count == 0; }
+  inline int Get() const { return count; }
+};
+
+class AtomicRefCount {
+private:
+  std::atomic<int> count{1};
+
+public:
+  inline void Increment() { count.fetch_add(1, std::memory_order_relaxed); }
+  inline bool IncrementIfNonZero() {
+    int current = count.load(std::memory_order_relaxed);
+    while (current != 0) {
+      if (count.compare_exchange_weak(current, current + 1,
+                                      std::memory_order_relaxed)) {
+        return true;
+      }
+    }
+    return false;
+  }
+  inline bool Decrement() {
+    return count.fetch_sub(1, std::memory_order_acq_rel) == 1;
+  }
+  inline int Get() const { return count.load(std::memory_order_relaxed); }
+};
+
+#ifndef SIM_ATOMIC_REFS
+#define SIM_ATOMIC_REFS 1
+#endif
+
+#if SIM_ATOMIC_REFS
+using DefaultRefCount = AtomicRefCount;
+#else
+using DefaultRefCount = LocalRefCount;
+#endif
+
+// Counts of one object. The object is destroyed, through its own type so
+// that a Ref<Base> releases a Derived correctly, when the last Ref goes;
+// the control block itself when the last WeakRef goes too.
+template <typename Count> class RefControl {
+public:
+  Count count;     // Refs
+  Count weakCount; // WeakRefs, plus one for all Refs together
+
+  void Release() {
+    if (count.Decrement()) {
+      DestroyObject();
+      ReleaseWeak();
+    }
+  }
+  void ReleaseWeak() {
+    if (weakCount.Decrement()) {
+      Free();
+    }
+  }
+
+protected:
+  ~RefControl() = default;
+  virtual void DestroyObject() = 0;
+  virtual void Free() = 0;
+};
+
+// Object and counts in one allocation
+template <typename Object, typename Count>
+class RefStorage : public RefControl<Count> {
+private:
+  alignas(Object) unsigned char storage[sizeof(Object)];
+
+  void DestroyObject() final { Get()->~Object(); }
+
+protected:
+  ~RefStorage() = default;
+
+public:
+  template <typename... Args> explicit RefStorage(Args &&...args) {
+    new (storage) Object(std::forward<Args>(args)...);
+  }
+
+  inline Object *Get() {
+    return std::launder(reinterpret_cast<Object *>(storage));
+  }
+};
+
+// On the heap, made by MakeRef
+template <typename Object, typename Count>
+class RefInline final : public RefStorage<Object, Count> {
+private:
+  void Free() override { delete this; }
+
+public:
+  using RefStorage<Object, Count>::RefStorage;
+};
+
+// In memory from a std::pmr::memory_resource, made by AllocateRef. Holds
+// a reference to the resource when it is itself held by Refs.
+template <typename Object, typename Count>
+class RefAllocated final : public RefStorage<Object, Count> {
+private:
+  std::pmr::memory_resource *resource;
+  RefControl<Count> *owner; // Counts of the resource, or null
+
+  void Free() override {
+    std::pmr::memory_resource *from = resource;
+    RefControl<Count> *fromOwner = owner;
+    this->~RefAllocated();
+    from->deallocate(this, sizeof(RefAllocated), alignof(RefAllocated));
+    if (fromOwner) {
+      fromOwner->Release();
+    }
+  }
+
+public:
+  template <typename... Args>
+  explicit RefAllocated(std::pmr::memory_resource *resource,
+                        RefControl<Count> *owner, Args &&...args)
+      : RefStorage<Object, Count>(std::forward<Args>(args)...),
+        resource(resource), owner(owner) {
+    if (owner) {
+      owner->count.Increment();
+    }
+  }
+};
+
+// Counts for an object allocated by the caller
+template <typename Object, typename Count>
+class RefPointer final : public RefControl<Count> {
+private:
+  Object *object;
+
+  void DestroyObject() override { delete object; }
+  void Free() override { delete this; }
+
+public:
+  explicit RefPointer(Object *object) : object(object) {}
+};
+
+template <typename T, typename Count = DefaultRefCount> class Ref;
+template <typename T, typename Count = DefaultRefCount> class WeakRef;
+
+template <typename> struct IsRef : std::false_type {};
+template <typename T, typename Count>
+struct IsRef<Ref<T, Count>> : std::true_type {};
+
+template <typename T, typename Count = DefaultRefCount, typename... Args>
+Ref<T, Count> MakeRef(Args &&...args);
+template <typename T, typename Count = DefaultRefCount, typename... Args>
+Ref<T, Count> AllocateRef(std::pmr::memory_resource &resource,
+                          Args &&...args);
+template <typename T, typename Count = DefaultRefCount, typename Resource,
+          typename... Args>
+Ref<T, Count> AllocateRef(const Ref<Resource, Count> &resource,
+                          Args &&...args);
+
+template <typename T, typename Count> class Ref {
+private:
+  template <typename, typename> friend class Ref;
+  template <typename, typename> friend class WeakRef;
+  template <typename U, typename C, typename... Args>
+  friend Ref<U, C> MakeRef(Args &&...args);
+  template <typename U, typename C, typename... Args>
+  friend Ref<U, C> AllocateRef(std::pmr::memory_resource &resource,
+                               Args &&...args);
+  template <typename U, typename C, typename R, typename... Args>
+  friend Ref<U, C> AllocateRef(const Ref<R, C> &resource, Args &&...args);
+
   T *m_ptr;
-  int *m_refCount;
+  RefControl<Count> *m_control;
+
+  struct Adopt {};
+  Ref(Adopt, RefStorage<T, Count> *control)
+      : m_ptr(control->Get()), m_control(control) {}
 
   void cleanup() {
-    if (m_refCount && *m_refCount > 0) {
-      --(*m_refCount);
-      if (*m_refCount == 0) {
-        delete m_ptr;
-        delete m_refCount;
-      }
+    if (m_control) {
+      m_control->Release();
     }
     m_ptr = nullptr;
-    m_refCount = nullptr;
+    m_control = nullptr;
   }
 
-  void acquire(T *ptr, int *refCount) {
+  void acquire(T *ptr, RefControl<Count> *control) {
     m_ptr = ptr;
-    m_refCount = refCount;
-    if (m_refCount) {
-      ++(*m_refCount);
+    m_control = control;
+    if (m_control) {
+      m_control->count.Increment();
     }
   }
 
+  // Arguments that select another constructor rather than construct a
+  // new T: a single Ref or pointer (copy, move, conversion, ownership), or
+  // the tag of a control block made by MakeRef or AllocateRef
+  template <typename... Args> struct IsRefArgument : std::false_type {};
+  template <typename Arg>
+  struct IsRefArgument<Arg>
+      : std::bool_constant<IsRef<std::decay_t<Arg>>::value ||
+                           std::is_convertible_v<std::decay_t<Arg>, T *>> {};
+  template <typename Arg, typename Control>
+  struct IsRefArgument<Arg, Control>
+      : std::is_same<std::decay_t<Arg>, Adopt> {};
+
 public:
   // Default constructor - creates null reference
-  Ref() : m_ptr(nullptr), m_refCount(nullptr) {}
-
-  // Constructor from raw pointer
-  template <typename Derived>
-  explicit Ref(Derived *ptr) : m_ptr(nullptr), m_refCount(nullptr) {
-    static_assert(
-        std::is_base_of_v<T, Derived> || std::is_same_v<T, Derived>,
-        "Ref can only be constructed from T or classes derived from T");
+  Ref() : m_ptr(nullptr), m_control(nullptr) {}
+
+  // Takes ownership of an object allocated with new, of T or a class
+  // derived from T. MakeRef saves the separate allocation of the count.
+  template <typename Derived,
+            typename = std::enable_if_t<std::is_convertible_v<Derived *, T *>>>
+  explicit Ref(Derived *ptr) : m_ptr(nullptr), m_control(nullptr) {
     if (ptr) {
       m_ptr = ptr;
-      m_refCount = new int(1);
+      m_control = new RefPointer<Derived, Count>(ptr);
     }
   }
 
-  // Constructor with perfect forwarding for object creation
-  template <typename... Args>
-  explicit Ref(Args &&...args) : m_ptr(nullptr), m_refCount(nullptr) {
-    m_ptr = new T(std::forward<Args>(args)...);
-    m_refCount = new int(1);
-  }
+  // Constructs a T in place, as MakeRef<T>(args...)
+  template <typename... Args,
+            typename = std::enable_if_t<!IsRefArgument<Args...>::value>>
+  explicit Ref(Args &&...args)
+      : Ref(Adopt(),
+            new RefInline<T, Count>(std::forward<Args>(args)...)) {}
 
   // Copy constructor
-  Ref(const Ref &other) : m_ptr(nullptr), m_refCount(nullptr) {
-    acquire(other.m_ptr, other.m_refCount);
+  Ref(const Ref &other) : m_ptr(nullptr), m_control(nullptr) {
+    acquire(other.m_ptr, other.m_control);
   }
 
   // Move constructor
-  Ref(Ref &&other) noexcept : m_ptr(other.m_ptr), m_refCount(other.m_refCount) {
+  Ref(Ref &&other) noexcept : m_ptr(other.m_ptr), m_control(other.m_control) {
     other.m_ptr = nullptr;
-    other.m_refCount = nullptr;
+    other.m_control = nullptr;
+  }
+
+  // Shares ownership of a derived object
+  template <typename Derived,
+            typename = std::enable_if_t<std::is_convertible_v<Derived *, T *> &&
+                                        !std::is_same_v<Derived, T>>>
+  Ref(const Ref<Derived, Count> &other) : m_ptr(nullptr), m_control(nullptr) {
+    acquire(other.m_ptr, other.m_control);
+  }
+  template <typename Derived,
+            typename = std::enable_if_t<std::is_convertible_v<Derived *, T *> &&
+                                        !std::is_same_v<Derived, T>>>
+  Ref(Ref<Derived, Count> &&other) noexcept
+      : m_ptr(other.m_ptr), m_control(other.m_control) {
+    other.m_ptr = nullptr;
+    other.m_control = nullptr;
   }
 
   // Copy assignment
   Ref &operator=(const Ref &other) {
     if (this != &other) {
-      cleanup();
-      acquire(other.m_ptr, other.m_refCount);
+      // Acquire first: `other` may be owned by the object released here
+      Ref(other).swap(*this);
     }
     return *this;
   }
@@ -73,11 +287,7 @@ public:
   // Move assignment
   Ref &operator=(Ref &&other) noexcept {
     if (this != &other) {
-      cleanup();
-      m_ptr = other.m_ptr;
-      m_refCount = other.m_refCount;
-      other.m_ptr = nullptr;
-      other.m_refCount = nullptr;
+      Ref(std::move(other)).swap(*this);
     }
     return *this;
   }
@@ -85,6 +295,11 @@ public:
   // Destructor
   ~Ref() { cleanup(); }
 
+  void swap(Ref &other) noexcept {
+    std::swap(m_ptr, other.m_ptr);
+    std::swap(m_control, other.m_control);
+  }
+
   // Dereference operators
   T &operator*() const {
     assert(m_ptr != nullptr && "Attempting to dereference null Ref");
@@ -106,7 +321,7 @@ public:
   T *get() const { return m_ptr; }
 
   // Get reference count (for debugging)
-  int use_count() const { return m_refCount ? *m_refCount : 0; }
+  int use_count() const { return m_control ? m_control->count.Get() : 0; }
 
   // Reset to null
   void reset() { cleanup(); }
@@ -120,3 +335,148 @@ public:
 
   bool operator!=(std::nullptr_t) const { return m_ptr != nullptr; }
 };
+
+// Allocates the object and its reference count together
+//
+//   Ref<CalculationMethod> method = MakeRef<Evaporator::MethodX>(block);
+template <typename T, typename Count, typename... Args>
+Ref<T, Count> MakeRef(Args &&...args) {
+  return Ref<T, Count>(typename Ref<T, Count>::Adopt(),
+                       new RefInline<T, Count>(std::forward<Args>(args)...));
+}
+
+namespace RefDetail {
+template <typename T, typename Count, typename... Args>
+RefAllocated<T, Count> *Allocate(std::pmr::memory_resource &resource,
+                                 RefControl<Count> *owner, Args &&...args) {
+  using Control = RefAllocated<T, Count>;
+  void *memory = resource.allocate(sizeof(Control), alignof(Control));
+  try {
+    return new (memory)
+        Control(&resource, owner, std::forward<Args>(args)...);
+  } catch (...) {
+    resource.deallocate(memory, sizeof(Control), alignof(Control));
+    throw;
+  }
+}
+} // namespace RefDetail
+
+// Like MakeRef, with the object and its counts in memory from `resource`
+// (e.g. a FlowsheetArena), which must outlive the object
+template <typename T, typename Count, typename... Args>
+Ref<T, Count> AllocateRef(std::pmr::memory_resource &resource,
+                          Args &&...args) {
+  return Ref<T, Count>(typename Ref<T, Count>::Adopt(),
+                       RefDetail::Allocate<T, Count>(
+                           resource, nullptr, std::forward<Args>(args)...));
+}
+
+// As above, with the object keeping the resource alive
+template <typename T, typename Count, typename Resource, typename... Args>
+Ref<T, Count> AllocateRef(const Ref<Resource, Count> &resource,
+                          Args &&...args) {
+  static_assert(std::is_base_of_v<std::pmr::memory_resource, Resource>,
+                "AllocateRef needs a Ref to a std::pmr::memory_resource");
+  assert(resource && "AllocateRef from a null resource");
+  return Ref<T, Count>(typename Ref<T, Count>::Adopt(),
+                       RefDetail::Allocate<T, Count>(
+                           *resource, resource.m_control,
+                           std::forward<Args>(args)...));
+}
+
+// Non-owning reference to an object held by Refs, for back links that
+// would otherwise form ownership cycles. It does not keep the object
+// alive: Lock() returns an owning Ref, or a null Ref once the last Ref is
+// gone. Access through -> or * is for code that knows an owner outlives
+// the call, e.g. a calculation method reaching its block.
+template <typename T, typename Count> class WeakRef {
+private:
+  template <typename, typename> friend class WeakRef;
+
+  T *m_ptr;
+  RefControl<Count> *m_control;
+
+  void cleanup() {
+    if (m_control) {
+      m_control->ReleaseWeak();
+    }
+    m_ptr = nullptr;
+    m_control = nullptr;
+  }
+
+  void acquire(T *ptr, RefControl<Count> *control) {
+    m_ptr = ptr;
+    m_control = control;
+    if (m_control) {
+      m_control->weakCount.Increment();
+    }
+  }
+
+public:
+  WeakRef() : m_ptr(nullptr), m_control(nullptr) {}
+
+  template <typename Derived,
+            typename = std::enable_if_t<std::is_convertible_v<Derived *, T *>>>
+  WeakRef(const Ref<Derived, Count> &ref) : m_ptr(nullptr), m_control(nullptr) {
+    acquire(ref.m_ptr, ref.m_control);
+  }
+
+  WeakRef(const WeakRef &other) : m_ptr(nullptr), m_control(nullptr) {
+    acquire(other.m_ptr, other.m_control);
+  }
+
+  WeakRef(WeakRef &&other) noexcept
+      : m_ptr(other.m_ptr), m_control(other.m_control) {
+    other.m_ptr = nullptr;
+    other.m_control = nullptr;
+  }
+
+  WeakRef &operator=(const WeakRef &other) {
+    if (this != &other) {
+      WeakRef(other).swap(*this);
+    }
+    return *this;
+  }
+
+  WeakRef &operator=(WeakRef &&other) noexcept {
+    if (this != &other) {
+      WeakRef(std::move(other)).swap(*this);
+    }
+    return *this;
+  }
+
+  ~WeakRef() { cleanup(); }
+
+  void swap(WeakRef &other) noexcept {
+    std::swap(m_ptr, other.m_ptr);
+    std::swap(m_control, other.m_control);
+  }
+
+  // An owning Ref, null if the object was destroyed
+  Ref<T, Count> Lock() const {
+    Ref<T, Count> ref;
+    if (m_control && m_control->count.IncrementIfNonZero()) {
+      ref.m_ptr = m_ptr;
+      ref.m_control = m_control;
+    }
+    return ref;
+  }
+
+  // True when null or when the last Ref is gone
+  bool Expired() const { return !m_control || m_control->count.Get() == 0; }
+
+  T &operator*() const {
+    assert(!Expired() && "Attempting to dereference expired WeakRef");
+    return *m_ptr;
+  }
+
+  T *operator->() const {
+    assert(!Expired() && "Attempting to access expired WeakRef");
+    return m_ptr;
+  }
+
+  // Get raw pointer, dangling once expired
+  T *get() const { return m_ptr; }
+
+  void reset() { cleanup(); }
+};
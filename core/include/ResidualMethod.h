@@ -0,0 +1,141 @@
+#pragma once
+#include "CalculationBlock.h"
+#include "CalculationMethod.h"
+#include "Dual.h"
+#include "Numeric.h"
+#include "Profiler.h"
+#include "RunStatistics.h"
+#include "SimulationError.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <initializer_list>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+// Calculation method that solves N local equations with Newton's method,
+// split into phases so the inner loop only evaluates what depends on the
+// unknowns:
+//   Setup()     once per Calculate(): reads inputs, caches everything that
+//               is fixed during the solve and sets the initial guess
+//   Residuals() once per Newton iteration: the N residuals at the unknowns,
+//               on dual numbers, so the Jacobian needs no extra residual
+//               calls (see Steam.h for how property derivatives are taken)
+//   Store()     once after the solve: writes results back to the block
+// Residuals() is last called at the returned solution, so values it keeps
+// in members can be written out by Store(). Setup() may narrow the bounds
+// on the unknowns; Newton steps are projected onto them.
+//
+// If the solve does not converge, Calculate() throws CalculationError
+// without calling Store(), so a failed block stops the run.
+//
+// Warm start: the last converged solution replaces Setup()'s initial guess
+// on the next call, as long as none of the inputs passed to WatchInputs()
+// moved by more than `warmStartJump` relative to that solve. A warm start
+// that fails to converge is retried from the cold guess.
+template <size_t N> class ResidualMethod : public CalculationMethod {
+public:
+  using Number = Dual<N>;
+  using Unknowns = std::array<Number, N>;
+  using Vector = typename FixedNewton<N>::Vector;
+
+  static constexpr size_t MaxWatchedInputs = 16;
+
+private:
+  bool hasSolution = false;
+  Vector lastSolution;
+  std::array<double, MaxWatchedInputs> lastInputs;
+  std::array<double, MaxWatchedInputs> inputs;
+  size_t inputCount = 0;
+
+  bool InputsJumped() const {
+    for (size_t i = 0; i < inputCount; ++i) {
+      double scale = std::max(std::abs(lastInputs[i]), 1.0);
+      if (!(std::abs(inputs[i] - lastInputs[i]) <= warmStartJump * scale)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+protected:
+  typename FixedNewton<N>::SolverOptions solverOptions;
+  Vector lowerBounds;
+  Vector upperBounds;
+  bool warmStart = true;
+  double warmStartJump = 0.25;
+
+  virtual void Setup(Vector &initialGuess) = 0;
+  virtual void Residuals(const Unknowns &x, Unknowns &residuals) = 0;
+  virtual void Store() = 0;
+
+  // Called from Setup() with the inputs the solution depends on
+  void WatchInputs(std::initializer_list<double> values) {
+    if (values.size() > MaxWatchedInputs) {
+      throw std::logic_error("Method " + name + " watches too many inputs");
+    }
+    std::copy(values.begin(), values.end(), inputs.begin());
+    inputCount = values.size();
+  }
+
+public:
+  ResidualMethod(const Ref<CalculationBlock> &parent, const std::string &name)
+      : CalculationMethod(parent, name) {
+    lowerBounds.fill(-std::numeric_limits<double>::infinity());
+    upperBounds.fill(std::numeric_limits<double>::infinity());
+  }
+
+  void ResetWarmStart() override { hasSolution = false; }
+
+  void Calculate() override {
+    SIM_PROFILE_SCOPE(scope, "newton", parent->GetId());
+    SIM_PROFILE(int evaluations = 0);
+    Vector coldGuess;
+    inputCount = 0;
+    Setup(coldGuess);
+
+    bool warm = warmStart && hasSolution && !InputsJumped();
+    Vector x = warm ? lastSolution : coldGuess;
+
+    Unknowns unknowns;
+    Unknowns residuals;
+    auto system = [&](const Vector &values, Vector &out,
+                      typename FixedNewton<N>::Matrix &J) {
+      RunStatistics::CountResidualEvaluations();
+      SIM_PROFILE(++evaluations);
+      for (size_t i = 0; i < N; ++i) {
+        unknowns[i] = Number::Variable(values[i], i);
+      }
+      Residuals(unknowns, residuals);
+      for (size_t i = 0; i < N; ++i) {
+        out[i] = residuals[i].value;
+        J[i] = residuals[i].gradient;
+      }
+    };
+    FixedNewton<N> solver(solverOptions);
+    solver.set_bounds(lowerBounds, upperBounds);
+    auto result = solver.solve(system, x);
+    SIM_PROFILE(int iterations = result.iterations);
+    if (!result.converged && warm) {
+      x = coldGuess;
+      result = solver.solve(system, x);
+      SIM_PROFILE(iterations += result.iterations);
+    }
+    SIM_PROFILE(scope.SetIterations(iterations));
+    SIM_PROFILE(scope.SetResidualEvaluations(evaluations));
+    SIM_PROFILE(scope.SetResidual(result.residual_norm));
+    SIM_PROFILE(scope.SetStatus(to_string(result.status)));
+
+    hasSolution = result.converged;
+    if (!result.converged) {
+      throw CalculationError(parent->GetId(), name, result.status,
+                             result.residual_norm);
+    }
+    lastSolution = x;
+    lastInputs = inputs;
+
+    Store();
+  }
+};
@@ -0,0 +1,53 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+// Work done by simulation runs, summed over all threads since the last
+// Reset(). Every thread counts in its own counters, which Get() adds up,
+// so counting is a plain increment that never contends between threads.
+// Get() and Reset() are meant for points where no run is in progress.
+struct RunStatistics {
+  // Passes of the tear stream runners over a recycle loop and Newton
+  // iterations of the equation-oriented solve
+  uint64_t outerIterations = 0;
+  // CalculationBlock::Calculate() calls made by the runners
+  uint64_t calculateCalls = 0;
+  // Residual evaluations of local (ResidualMethod) and equation-oriented
+  // solves; one per block and evaluation
+  uint64_t residualEvaluations = 0;
+
+  static RunStatistics Get();
+  static void Reset();
+
+  static inline void CountOuterIteration() {
+    Add(Local().outerIterations, 1);
+  }
+  static inline void CountCalculate() { Add(Local().calculateCalls, 1); }
+  static inline void CountResidualEvaluations(uint64_t count = 1) {
+    Add(Local().residualEvaluations, count);
+  }
+
+private:
+  // Counts of one thread. Only that thread writes them; they are atomic
+  // so that Get() can read them from another thread.
+  struct Counters {
+    std::atomic<uint64_t> outerIterations{0};
+    std::atomic<uint64_t> calculateCalls{0};
+    std::atomic<uint64_t> residualEvaluations{0};
+
+    Counters();  // Registers the counters for Get()
+    ~Counters(); // Keeps their counts when the thread exits
+  };
+  struct Registry;
+
+  static Registry &GetRegistry();
+
+  static inline Counters &Local() {
+    static thread_local Counters counters;
+    return counters;
+  }
+  static inline void Add(std::atomic<uint64_t> &counter, uint64_t count) {
+    counter.store(counter.load(std::memory_order_relaxed) + count,
+                  std::memory_order_relaxed);
+  }
+};
@@ -1,13 +1,9 @@
 #pragma once
 
-#include "CalculationBlock.h"
-#include "Connector.h"
-#include "Ref.h"
-#include <vector>
+#include "FlowsheetGraph.h"
 
 class Runner {
 public:
-  virtual void Run(const std::vector<Ref<CalculationBlock>> &blocks,
-                   const std::vector<Ref<Connector>> &connectors) = 0;
+  virtual void Run(const FlowsheetGraph &graph) = 0;
   virtual ~Runner() = default;
 };
@@ -0,0 +1,32 @@
+#pragma once
+#include "Numeric.h"
+#include <stdexcept>
+#include <string>
+
+// Base of the errors that stop a simulation run
+class SimulationError : public std::runtime_error {
+public:
+  using std::runtime_error::runtime_error;
+};
+
+// A block's calculation method could not solve its equations
+class CalculationError : public SimulationError {
+private:
+  std::string blockId;
+  std::string methodName;
+  SolverStatus status;
+
+public:
+  CalculationError(const std::string &blockId, const std::string &methodName,
+                   SolverStatus status, double residualNorm);
+
+  inline const std::string &GetBlockId() const { return blockId; }
+  inline const std::string &GetMethodName() const { return methodName; }
+  inline SolverStatus GetStatus() const { return status; }
+};
+
+// A runner could not converge a recycle loop or the flowsheet
+class ConvergenceError : public SimulationError {
+public:
+  using SimulationError::SimulationError;
+};
@@ -1,10 +1,20 @@
 #pragma once
 #include "CalculationBlock.h"
 #include "Connector.h"
+#include "FlowsheetArena.h"
 #include "Ref.h"
 #include "Runner.h"
 #include <vector>
 
+// Blocks and connectors of one flowsheet
+struct Flowsheet {
+  // Optional; holds the memory of the objects built with arena->Make.
+  // Declared first so that it is destroyed after them.
+  Ref<FlowsheetArena> arena;
+  std::vector<Ref<CalculationBlock>> blocks;
+  std::vector<Ref<Connector>> connectors;
+};
+
 class Simulator {
 private:
   Ref<Runner> runner;
@@ -13,6 +23,12 @@ private:
 
 public:
   Simulator();
+  explicit Simulator(const Ref<Runner> &runner);
+
+  inline void SetRunner(const Ref<Runner> &runner) { this->runner = runner; }
   void Run(const std::vector<Ref<CalculationBlock>> &blocks,
            const std::vector<Ref<Connector>> &connectors);
+  inline void Run(const Flowsheet &flowsheet) {
+    Run(flowsheet.blocks, flowsheet.connectors);
+  }
 };
@@ -0,0 +1,27 @@
+#pragma once
+#include <cstddef>
+#include <map>
+#include <vector>
+
+// Square sparse matrix stored by rows, assembled from (row, column, value)
+// entries
+class SparseMatrix {
+private:
+  size_t n;
+  std::vector<std::map<size_t, double>> rows;
+
+public:
+  explicit SparseMatrix(size_t n);
+
+  inline size_t Size() const { return n; }
+  size_t NonZeros() const;
+
+  // Accumulates into the entry
+  void Add(size_t row, size_t column, double value);
+
+  // Solves A x = b by sparse Gaussian elimination. Pivots are chosen per
+  // column among rows within a factor of the largest magnitude, preferring
+  // the sparsest row to limit fill-in. Throws ConvergenceError if the
+  // matrix is singular.
+  std::vector<double> Solve(std::vector<double> b) const;
+};
@@ -0,0 +1,35 @@
+#pragma once
+#include <cstddef>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+// Fixed, ordered set of variables carried by a stream. Each variable gets a
+// slot index, so pins can store their values in a flat array.
+class StreamSchema {
+public:
+  static constexpr size_t MaxVariables = 8;
+  static constexpr size_t npos = static_cast<size_t>(-1);
+
+private:
+  std::string name;
+  std::vector<std::string> variables;
+
+public:
+  StreamSchema(const std::string &name,
+               std::initializer_list<std::string> variables);
+
+  inline const std::string &GetName() const { return this->name; }
+  inline size_t Size() const { return this->variables.size(); }
+  inline const std::string &GetVariableName(size_t slot) const {
+    return this->variables[slot];
+  }
+
+  // Returns npos if the variable is not part of the schema
+  size_t FindSlot(const std::string &variableName) const;
+  // Throws std::out_of_range if the variable is not part of the schema
+  size_t GetSlot(const std::string &variableName) const;
+
+  // Schema without variables, used by default-constructed pins
+  static const StreamSchema &Empty();
+};
@@ -0,0 +1,26 @@
+#pragma once
+#include "FlowsheetGraph.h"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Tear connectors chosen to break every cycle of one recycle loop
+struct TearSet {
+  std::vector<size_t> connectors; // Compiled connector indices
+  size_t variableCount = 0;       // Total tear variables across connectors
+  size_t cycleCount = 0;          // Elementary cycles the set has to break
+  bool automatic = false;         // False when the user's marks were used
+};
+
+// Number of variables a connector carries into its target pin
+size_t TearVariableCount(const CompiledConnector &conn);
+
+// Selects the tear connectors of a cyclic component. Connectors the user
+// marked with Connector::MarkAsTearStream take precedence; otherwise a
+// minimum-weight set (weight = variables per connector) covering every
+// elementary cycle is searched for.
+TearSet SelectTearStreams(const FlowsheetGraph &graph,
+                          const FlowsheetComponent &component);
+
+// The chosen tears and their variable counts, one connector per line
+std::string DescribeTearSet(const FlowsheetGraph &graph, const TearSet &tears);
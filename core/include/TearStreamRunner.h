@@ -0,0 +1,79 @@
+#pragma once
+#include "FlowsheetGraph.h"
+#include "Runner.h"
+#include "TearSelection.h"
+#include <string>
+#include <vector>
+
+// Tear variables of a recycle loop, enumerated once: where each computed
+// value is read and where its guess is written
+struct TearVariables {
+  std::vector<const double *> source; // Computed value (origin output slot)
+  std::vector<double *> target;       // Guessed value (target input slot)
+
+  inline size_t Size() const { return source.size(); }
+};
+
+// Recycle loop ready to be iterated
+struct RecycleLoop {
+  TearSet tears;
+  std::vector<bool> torn;         // Indexed by connector
+  std::vector<BlockHandle> order; // Calculation order with the tears cut
+  TearVariables variables;
+};
+
+// Base class of runners that converge recycle loops through tear streams.
+// Acyclic components are calculated once, in topological order; each cyclic
+// component is handed to ConvergeComponent. A loop that does not converge,
+// or a block that fails inside it, stops the run with an exception.
+class TearStreamRunner : public Runner {
+protected:
+  static constexpr double MAX_REL_ERROR = 1e-6;
+  static constexpr double MAX_ABS_ERROR = 1e-8;
+  static constexpr int MAX_ITERATIONS = 100;
+
+  // Selects the tear streams, orders the loop and seeds the tear guesses
+  static RecycleLoop PrepareLoop(const FlowsheetGraph &graph,
+                                 const FlowsheetComponent &component);
+
+  // One pass through the loop's blocks; tear targets keep their guesses
+  static void CalculateLoop(const FlowsheetGraph &graph,
+                            const RecycleLoop &loop);
+
+  // True when every output is within both tolerances of its guess
+  static bool IsConverged(const double *guesses, const double *outputs,
+                          size_t n);
+
+  // Largest relative change of a tear variable (absolute near zero), for
+  // reporting
+  static double TearResidual(const double *guesses, const double *outputs,
+                             size_t n);
+
+  // Names the loop after its first block, for reporting
+  static std::string LoopLabel(const FlowsheetGraph &graph,
+                               const RecycleLoop &loop);
+
+  // Throws ConvergenceError if a tear output is NaN or infinite, so a loop
+  // that went astray stops instead of iterating on garbage
+  static void CheckFinite(const FlowsheetGraph &graph, const RecycleLoop &loop,
+                          const double *outputs, int iteration);
+
+  // Throws ConvergenceError for a loop that ran out of iterations
+  [[noreturn]] static void FailToConverge(const FlowsheetGraph &graph,
+                                          const RecycleLoop &loop);
+
+  virtual std::string GetName() const = 0;
+
+public:
+  void Run(const FlowsheetGraph &graph) override;
+
+  // Iterate one recycle loop until its tear streams converge.
+  // Implementations keep no state between calls, so loops may be converged
+  // concurrently.
+  virtual void ConvergeComponent(const FlowsheetGraph &graph,
+                                 const FlowsheetComponent &component) = 0;
+
+  // Calculate blocks once, in the given order
+  static void RunSequential(const FlowsheetGraph &graph,
+                            const std::vector<BlockHandle> &order);
+};
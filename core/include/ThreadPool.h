@@ -0,0 +1,56 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed-size pool of workers with one task deque each. A worker pops the
+// newest task from its own deque and, when that is empty, steals the oldest
+// task from the other workers.
+class ThreadPool {
+public:
+  using Task = std::function<void()>;
+
+private:
+  struct Worker {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  std::vector<std::unique_ptr<Worker>> workers;
+  std::vector<std::thread> threads;
+
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::condition_variable idle;
+  std::atomic<size_t> queued{0};  // Tasks waiting in a deque
+  std::atomic<size_t> pending{0}; // Tasks submitted and not yet finished
+  std::atomic<size_t> nextWorker{0};
+  bool stopping = false;
+
+  bool TryPop(size_t index, Task &task);
+  void WorkerLoop(size_t index);
+
+public:
+  // Zero threads means one per hardware thread
+  explicit ThreadPool(size_t threadCount = 0);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  inline size_t ThreadCount() const { return threads.size(); }
+
+  // Tasks must not throw. Tasks submitted from a worker go to that worker's
+  // own deque.
+  void Submit(Task task);
+
+  // Blocks until every submitted task, including tasks submitted by other
+  // tasks, has finished
+  void Wait();
+};
@@ -0,0 +1,212 @@
+#pragma once
+#include "CalculationBlock.h"
+#include "Pin.h"
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <utility>
+
+// Pin seen as a stream of a known type. Variables are addressed by that
+// stream's slot enum only, so a variable of another stream does not compile.
+template <typename Stream> class StreamRef {
+private:
+  Pin *pin;
+
+public:
+  explicit StreamRef(Pin &pin) : pin(&pin) {}
+
+  inline double Get(typename Stream::Slot slot) const {
+    return pin->GetValue(slot);
+  }
+  inline void Set(typename Stream::Slot slot, double value) const {
+    pin->SetValue(slot, value);
+  }
+  inline double *Data() const { return pin->Data(); }
+  inline size_t Size() const { return pin->Size(); }
+  inline bool IsLinked() const { return pin->IsLinked(); }
+  inline Pin &GetPin() const { return *pin; }
+};
+
+// Parameter of a block layout, with the value a block constructed without
+// it gets. Required parameters have no such value.
+struct ParamInfo {
+  static constexpr double Required = std::numeric_limits<double>::quiet_NaN();
+
+  const char *name;
+  double defaultValue;
+};
+
+namespace TypedBlockDetail {
+
+constexpr bool SameName(const char *a, const char *b) {
+  while (*a != '\0' && *a == *b) {
+    ++a;
+    ++b;
+  }
+  return *a == *b;
+}
+
+template <size_t N, typename Name>
+constexpr bool UniqueNames(const Name (&items)[N],
+                           const char *(*nameOf)(const Name &)) {
+  for (size_t i = 0; i < N; ++i) {
+    if (nameOf(items[i]) == nullptr) {
+      return false;
+    }
+    for (size_t j = 0; j < i; ++j) {
+      if (SameName(nameOf(items[i]), nameOf(items[j]))) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+constexpr const char *ParamName(const ParamInfo &info) { return info.name; }
+constexpr const char *PortName(const char *const &name) { return name; }
+
+} // namespace TypedBlockDetail
+
+// Block whose parameters and ports are declared at compile time by a
+// layout, and addressed by enum rather than by name:
+//
+//   struct HeaterLayout {
+//     enum Param : size_t { UA, ParamCount };
+//     enum Input : size_t { Inlet, InputCount };
+//     enum Output : size_t { Outlet, OutputCount };
+//     static constexpr ParamInfo Params[ParamCount] = {
+//         {"UA", ParamInfo::Required}};
+//     static constexpr const char *Inputs[InputCount] = {"Inlet"};
+//     static constexpr const char *Outputs[OutputCount] = {"Outlet"};
+//     using InputStreams = std::tuple<SteamStream>;
+//     using OutputStreams = std::tuple<SteamStream>;
+//   };
+//
+//   class Heater : public TypedBlock<HeaterLayout> { ... };
+//   double T = In<Input::Inlet>().Get(SteamStream::T);
+//   Out<Output::Outlet>().Set(SteamStream::T, T + GetParam(Param::UA));
+//
+// The pins are created, and the parameters resolved, by the constructor;
+// accessors then index fixed arrays. Unknown or missing required
+// parameters in the ParamsMap throw std::invalid_argument there. A block
+// constructed from its ID alone leaves the required parameters NaN until
+// they are set; CheckParams() reports any that are not. The name-based
+// CalculationBlock API stays available for I/O and reports.
+template <typename Layout> class TypedBlock : public CalculationBlock {
+public:
+  using Param = typename Layout::Param;
+  using Input = typename Layout::Input;
+  using Output = typename Layout::Output;
+  using InputStreams = typename Layout::InputStreams;
+  using OutputStreams = typename Layout::OutputStreams;
+
+  static constexpr size_t ParamCount = Layout::ParamCount;
+  static constexpr size_t InputCount = Layout::InputCount;
+  static constexpr size_t OutputCount = Layout::OutputCount;
+
+  static_assert(std::tuple_size<InputStreams>::value == InputCount &&
+                    std::tuple_size<OutputStreams>::value == OutputCount,
+                "Every port needs a stream type");
+  static_assert(TypedBlockDetail::UniqueNames(Layout::Params,
+                                              TypedBlockDetail::ParamName),
+                "Parameter names must be given and unique");
+  static_assert(TypedBlockDetail::UniqueNames(Layout::Inputs,
+                                              TypedBlockDetail::PortName) &&
+                    TypedBlockDetail::UniqueNames(Layout::Outputs,
+                                                  TypedBlockDetail::PortName),
+                "Port names must be given and unique");
+
+private:
+  // Into the nodes of `params`, which stay put as the map grows
+  std::array<double *, ParamCount> paramSlots;
+  std::array<Pin *, InputCount> inputs;
+  std::array<Pin *, OutputCount> outputs;
+
+  void ResolveParams(bool requireAll) {
+    for (const auto &entry : this->params) {
+      bool declared = false;
+      for (const ParamInfo &info : Layout::Params) {
+        declared |= entry.first == info.name;
+      }
+      if (!declared) {
+        throw std::invalid_argument("Block " + this->id +
+                                    " has no parameter " + entry.first);
+      }
+    }
+
+    for (size_t p = 0; p < ParamCount; ++p) {
+      const ParamInfo &info = Layout::Params[p];
+      auto it = this->params.find(info.name);
+      if (it == this->params.end()) {
+        if (requireAll && std::isnan(info.defaultValue)) {
+          throw std::invalid_argument("Block " + this->id +
+                                      " needs parameter " + info.name);
+        }
+        it = this->params.emplace(info.name, info.defaultValue).first;
+      }
+      this->paramSlots[p] = &it->second;
+    }
+  }
+
+  template <size_t... I> void AddInputPorts(std::index_sequence<I...>) {
+    ((this->inputs[I] =
+          AddInputPin(Layout::Inputs[I],
+                      std::tuple_element_t<I, InputStreams>::Schema())
+              .get()),
+     ...);
+  }
+  template <size_t... O> void AddOutputPorts(std::index_sequence<O...>) {
+    ((this->outputs[O] =
+          AddOutputPin(Layout::Outputs[O],
+                       std::tuple_element_t<O, OutputStreams>::Schema())
+              .get()),
+     ...);
+  }
+
+  TypedBlock(const std::string &id, ParamsMap params, bool requireAll)
+      : CalculationBlock(id, std::move(params)) {
+    ResolveParams(requireAll);
+    AddInputPorts(std::make_index_sequence<InputCount>());
+    AddOutputPorts(std::make_index_sequence<OutputCount>());
+  }
+
+public:
+  TypedBlock(const std::string &id, ParamsMap params)
+      : TypedBlock(id, std::move(params), true) {}
+  explicit TypedBlock(const std::string &id)
+      : TypedBlock(id, ParamsMap(), false) {}
+  // The slots point into this block's own maps
+  TypedBlock(const TypedBlock &) = delete;
+  TypedBlock &operator=(const TypedBlock &) = delete;
+
+  using CalculationBlock::GetParam;
+  using CalculationBlock::SetParam;
+  inline double GetParam(Param param) const { return *paramSlots[param]; }
+  inline void SetParam(Param param, double value) {
+    *paramSlots[param] = value;
+  }
+
+  // Throws std::invalid_argument if a required parameter is still unset
+  void CheckParams() const {
+    for (size_t p = 0; p < ParamCount; ++p) {
+      if (std::isnan(*paramSlots[p])) {
+        throw std::invalid_argument("Block " + this->id + " needs parameter " +
+                                    Layout::Params[p].name);
+      }
+    }
+  }
+
+  template <Input port>
+  inline StreamRef<std::tuple_element_t<port, InputStreams>> In() const {
+    return StreamRef<std::tuple_element_t<port, InputStreams>>(*inputs[port]);
+  }
+  template <Output port>
+  inline StreamRef<std::tuple_element_t<port, OutputStreams>> Out() const {
+    return StreamRef<std::tuple_element_t<port, OutputStreams>>(
+        *outputs[port]);
+  }
+};
@@ -1,51 +1,31 @@
 #pragma once
-#include "CalculationBlock.h"
-#include "Connector.h"
-#include "Ref.h"
-#include "Runner.h"
-#include <map>
+#include "TearStreamRunner.h"
 #include <string>
-#include <vector>
 
 // Forward declaration
-struct WegsteinData;
+struct WegsteinState;
+
+// Converges each recycle loop with Wegstein's method, accelerating every
+// tear variable independently
+class WegsteinRunner : public TearStreamRunner {
+protected:
+  inline std::string GetName() const override { return "Wegstein"; }
 
-class WegsteinRunner : public Runner {
 public:
-  // Main method to run the Wegstein algorithm
-  void Run(const std::vector<Ref<CalculationBlock>> &blocks,
-           const std::vector<Ref<Connector>> &connectors);
+  void ConvergeComponent(const FlowsheetGraph &graph,
+                         const FlowsheetComponent &component) override;
 
 private:
-  // Run sequential calculation for acyclic flowsheets
-  void RunSequential(const std::vector<Ref<CalculationBlock>> &blocks,
-                     const std::vector<Ref<Connector>> &connectors);
-
-  // Initialize tear stream variables with initial guesses
-  void InitializeTearStreams(const std::vector<Ref<CalculationBlock>> &blocks,
-                             const std::vector<Ref<Connector>> &tearConnectors,
-                             std::map<std::string, WegsteinData> &wegsteinData);
-
   // Store current tear stream inputs before calculation
-  void StoreTearStreamInputs(const std::vector<Ref<CalculationBlock>> &blocks,
-                             const std::vector<Ref<Connector>> &tearConnectors,
-                             std::map<std::string, WegsteinData> &wegsteinData);
+  void StoreTearStreamInputs(const TearVariables &variables,
+                             WegsteinState &state);
 
   // Check convergence and update Wegstein data
-  bool
-  CheckConvergenceAndUpdate(const std::vector<Ref<CalculationBlock>> &blocks,
-                            const std::vector<Ref<Connector>> &tearConnectors,
-                            std::map<std::string, WegsteinData> &wegsteinData,
-                            double maxRelError, double maxAbsError);
-
-  // Apply Wegstein acceleration to get next iteration guesses
-  void
-  ApplyWegsteinAcceleration(const std::vector<Ref<CalculationBlock>> &blocks,
-                            const std::vector<Ref<Connector>> &tearConnectors,
-                            std::map<std::string, WegsteinData> &wegsteinData);
+  bool CheckConvergenceAndUpdate(const TearVariables &variables,
+                                 WegsteinState &state);
 
-  // Helper method to find a block by ID
-  Ref<CalculationBlock>
-  FindBlock(const std::vector<Ref<CalculationBlock>> &blocks,
-            const std::string &blockId);
+  // Apply Wegstein acceleration to get next iteration guesses (direct
+  // substitution after the first pass, which has no secant yet)
+  void ApplyWegsteinAcceleration(const TearVariables &variables,
+                                 WegsteinState &state, bool first);
 };
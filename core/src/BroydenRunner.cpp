@@ -0,0 +1,184 @@
+#include "BroydenRunner.h"
+#include "Log.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+double Dot(const std::vector<double> &a, const std::vector<double> &b) {
+  double sum = 0.0;
+  for (size_t i = 0; i < a.size(); ++i) {
+    sum += a[i] * b[i];
+  }
+  return sum;
+}
+
+// Inverse Jacobian approximation H = -I + sum_k u_k v_k^T
+class LowRankInverse {
+private:
+  size_t n;
+  std::vector<std::vector<double>> u;
+  std::vector<std::vector<double>> v;
+
+public:
+  explicit LowRankInverse(size_t n) : n(n) {}
+
+  inline size_t Rank() const { return u.size(); }
+
+  void Reset() {
+    u.clear();
+    v.clear();
+  }
+
+  // y = H x
+  void Apply(const std::vector<double> &x, std::vector<double> &y) const {
+    y.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+      y[i] = -x[i];
+    }
+    for (size_t k = 0; k < u.size(); ++k) {
+      double d = Dot(v[k], x);
+      for (size_t i = 0; i < n; ++i) {
+        y[i] += d * u[k][i];
+      }
+    }
+  }
+
+  // y = H^T x
+  void ApplyTransposed(const std::vector<double> &x,
+                       std::vector<double> &y) const {
+    y.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+      y[i] = -x[i];
+    }
+    for (size_t k = 0; k < u.size(); ++k) {
+      double d = Dot(u[k], x);
+      for (size_t i = 0; i < n; ++i) {
+        y[i] += d * v[k][i];
+      }
+    }
+  }
+
+  // "Good" Broyden update through Sherman-Morrison:
+  // H += (dx - H dF) dx^T H / (dx^T H dF)
+  // Returns false, leaving H unchanged, when the update is ill-conditioned.
+  bool Update(const std::vector<double> &dx, const std::vector<double> &dF) {
+    std::vector<double> HdF;
+    Apply(dF, HdF);
+    double denominator = Dot(dx, HdF);
+    double size = std::sqrt(Dot(dx, dx) * Dot(HdF, HdF));
+    if (!std::isfinite(denominator) || std::abs(denominator) <= 1e-12 * size) {
+      return false;
+    }
+
+    std::vector<double> uk(n);
+    for (size_t i = 0; i < n; ++i) {
+      uk[i] = (dx[i] - HdF[i]) / denominator;
+    }
+    std::vector<double> vk;
+    ApplyTransposed(dx, vk);
+
+    u.push_back(std::move(uk));
+    v.push_back(std::move(vk));
+    return true;
+  }
+};
+
+} // namespace
+
+BroydenRunner::BroydenRunner(const Options &options) : options(options) {}
+
+void BroydenRunner::ConvergeComponent(const FlowsheetGraph &graph,
+                                      const FlowsheetComponent &component) {
+  RecycleLoop loop = PrepareLoop(graph, component);
+  SIM_PROFILE_SCOPE(loopScope, "loop", LoopLabel(graph, loop));
+  const auto &variables = loop.variables;
+  size_t n = variables.Size();
+
+  // Unscaled guesses and outputs, for the convergence test
+  std::vector<double> guess(n);
+  std::vector<double> output(n);
+
+  // Scaled tear vector (x / scale) and residual (g(x) - x) / scale
+  std::vector<double> scale(n);
+  std::vector<double> x(n), F(n), xNew(n), FNew(n);
+  std::vector<double> dx(n), dF(n), step(n);
+
+  for (size_t i = 0; i < n; ++i) {
+    guess[i] = *variables.target[i];
+    scale[i] = std::max(std::abs(guess[i]), 1e-3);
+    xNew[i] = guess[i] / scale[i];
+  }
+
+  LowRankInverse H(n);
+  double residualNorm = 0.0;
+  bool converged = false;
+
+  for (int iteration = 0; iteration < MAX_ITERATIONS; ++iteration) {
+    SIM_PROFILE_SCOPE(scope, "broyden",
+                      "iteration " + std::to_string(iteration + 1));
+    CalculateLoop(graph, loop);
+
+    for (size_t i = 0; i < n; ++i) {
+      output[i] = *variables.source[i];
+    }
+    converged = IsConverged(guess.data(), output.data(), n);
+    SIM_PROFILE(double residual =
+                    TearResidual(guess.data(), output.data(), n));
+    SIM_PROFILE(scope.SetResidual(residual));
+    SIM_PROFILE_COUNTER("broyden", LoopLabel(graph, loop), residual);
+    CheckFinite(graph, loop, output.data(), iteration);
+    if (converged) {
+      SIM_PROFILE(loopScope.SetIterations(iteration + 1));
+      SIM_PROFILE(loopScope.SetStatus("converged"));
+      SIM_LOG(Info) << "Converged after " << (iteration + 1)
+                    << " iterations!";
+      break;
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+      FNew[i] = (output[i] - guess[i]) / scale[i];
+    }
+    double newNorm = std::sqrt(Dot(FNew, FNew));
+
+    if (iteration > 0) {
+      // Restart from direct substitution when the residual blows up, the
+      // update is ill-conditioned or the rank limit is reached
+      bool diverging = newNorm > options.divergenceRatio * residualNorm;
+      for (size_t i = 0; i < n; ++i) {
+        dx[i] = xNew[i] - x[i];
+        dF[i] = FNew[i] - F[i];
+      }
+      if (diverging || !H.Update(dx, dF) || H.Rank() > options.maxUpdates) {
+        H.Reset();
+      }
+    }
+
+    x.swap(xNew);
+    F.swap(FNew);
+    residualNorm = newNorm;
+
+    // Quasi-Newton step -H F, shortened so no variable moves by more than
+    // maxRelativeStep of its magnitude
+    H.Apply(F, step);
+    double factor = 1.0;
+    for (size_t i = 0; i < n; ++i) {
+      double limit = options.maxRelativeStep * std::max(std::abs(x[i]), 1.0);
+      if (std::abs(step[i]) * factor > limit) {
+        factor = limit / std::abs(step[i]);
+      }
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+      xNew[i] = x[i] - factor * step[i];
+      guess[i] = xNew[i] * scale[i];
+      *variables.target[i] = guess[i];
+    }
+  }
+
+  if (!converged) {
+    FailToConverge(graph, loop);
+  }
+}
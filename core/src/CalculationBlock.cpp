@@ -1,37 +1,43 @@
 #include "CalculationBlock.h"
-#include <iostream>
-CalculationBlock::CalculationBlock() : id("") {}
-CalculationBlock::CalculationBlock(const std::string &id) : id(id) {}
+CalculationBlock::CalculationBlock() : CalculationBlock("") {}
+CalculationBlock::CalculationBlock(const std::string &id)
+    : id(id), inputPins(FlowsheetArena::CurrentResource()),
+      outputPins(FlowsheetArena::CurrentResource()) {}
 CalculationBlock::CalculationBlock(const std::string &id, ParamsMap params)
-    : id(id), params(params) {}
+    : id(id), inputPins(FlowsheetArena::CurrentResource()),
+      outputPins(FlowsheetArena::CurrentResource()), params(params) {}
 
-// Add to CalculationBlock.cpp (or inline in header)
-void CalculationBlock::PrintAllValues() const {
-  std::cout << "\n=== Block: " << id << " ===" << std::endl;
+void CalculationBlock::PrintAllValues(std::ostream &out) const {
+  out << "\n=== Block: " << id << " ===\n";
 
   // Print parameters
-  std::cout << "\n--- Parameters ---" << std::endl;
+  out << "\n--- Parameters ---\n";
   for (const auto &[name, value] : params) {
-    std::cout << "  " << name << ": " << value << std::endl;
+    out << "  " << name << ": " << value << '\n';
   }
 
   // Print input pins
-  std::cout << "\n--- Input Pins ---" << std::endl;
+  out << "\n--- Input Pins ---\n";
   for (const auto &[pinName, pin] : inputPins) {
-    std::cout << "  Pin: " << pinName << std::endl;
-    for (const auto &[varName, value] : pin->GetValuesMap()) {
-      std::cout << "    " << varName << ": " << value << std::endl;
+    out << "  Pin: " << pinName << '\n';
+    const auto &schema = pin->GetSchema();
+    for (size_t slot = 0; slot < schema.Size(); ++slot) {
+      out << "    " << schema.GetVariableName(slot) << ": "
+          << pin->GetValue(slot) << '\n';
     }
   }
 
   // Print output pins
-  std::cout << "\n--- Output Pins ---" << std::endl;
+  out << "\n--- Output Pins ---\n";
   for (const auto &[pinName, pin] : outputPins) {
-    std::cout << "  Pin: " << pinName << std::endl;
-    for (const auto &[varName, value] : pin->GetValuesMap()) {
-      std::cout << "    " << varName << ": " << value << std::endl;
+    out << "  Pin: " << pinName << '\n';
+    const auto &schema = pin->GetSchema();
+    for (size_t slot = 0; slot < schema.Size(); ++slot) {
+      out << "    " << schema.GetVariableName(slot) << ": "
+          << pin->GetValue(slot) << '\n';
     }
   }
 
-  std::cout << "========================\n" << std::endl;
+  out << "========================\n\n";
+  out.flush();
 }
@@ -1,5 +1,6 @@
 #include "CalculationMethod.h"
 #include "CalculationBlock.h"
+#include <stdexcept>
 
 CalculationMethod::CalculationMethod(const Ref<CalculationBlock> &parent)
     : parent(parent) {}
@@ -8,3 +9,15 @@ CalculationMethod::CalculationMethod(const Ref<CalculationBlock> &parent,
     : parent(parent), name(name) {}
 
 void CalculationMethod::Calculate() {}
+
+void CalculationMethod::GetUnknowns(std::vector<double *> &) {
+  throw std::logic_error("Method " + name +
+                         " does not support equation-oriented mode");
+}
+
+void CalculationMethod::EvaluateResiduals(double *) {
+  throw std::logic_error("Method " + name +
+                         " does not support equation-oriented mode");
+}
+
+void CalculationMethod::UpdateDerivedValues() {}
@@ -0,0 +1,294 @@
+#include "CaseStudy.h"
+#include "CalculationBlock.h"
+#include "FlowsheetGraph.h"
+#include "ThreadPool.h"
+#include "WegsteinRunner.h"
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+
+CaseStudy::Variable CaseStudy::Variable::Param(const std::string &blockId,
+                                               const std::string &name) {
+  return {Parameter, blockId, "", name};
+}
+
+CaseStudy::Variable CaseStudy::Variable::Input(const std::string &blockId,
+                                               const std::string &pin,
+                                               const std::string &name) {
+  return {InputPin, blockId, pin, name};
+}
+
+CaseStudy::Variable CaseStudy::Variable::Output(const std::string &blockId,
+                                                const std::string &pin,
+                                                const std::string &name) {
+  return {OutputPin, blockId, pin, name};
+}
+
+std::string CaseStudy::Variable::Label() const {
+  if (kind == Parameter) {
+    return blockId + "." + name;
+  }
+  return blockId + ":" + pin + "." + name;
+}
+
+size_t CaseStudy::Results::FailureCount() const {
+  return std::count(succeeded.begin(), succeeded.end(), 0);
+}
+
+void CaseStudy::Results::WriteCsv(std::ostream &out) const {
+  out << "case";
+  for (const auto &label : columns) {
+    out << "," << label;
+  }
+  out << "\n";
+  for (size_t c = 0; c < caseCount; ++c) {
+    out << c;
+    for (size_t k = 0; k < columnCount; ++k) {
+      out << "," << Get(c, k);
+    }
+    out << "\n";
+  }
+}
+
+// One flowsheet instance with its compiled graph, runner and resolved
+// input/result locations. Used by one thread at a time.
+struct CaseStudy::Worker {
+  // A pin slot, or a block parameter if `pin` is null. Pins are accessed
+  // when the case runs, as the runner may link or unlink them.
+  struct Location {
+    Pin *pin;
+    size_t slot;
+    CalculationBlock *block;
+    std::string param;
+
+    inline double Get() const {
+      return pin ? pin->GetValue(slot) : block->GetParam(param);
+    }
+    inline void Set(double x) const {
+      if (pin) {
+        pin->SetValue(slot, x);
+      } else {
+        block->SetParam(param, x);
+      }
+    }
+  };
+
+  Flowsheet flowsheet;
+  std::unique_ptr<FlowsheetGraph> graph;
+  Ref<Runner> runner;
+  std::vector<Location> inputs;
+  std::vector<Location> results;
+
+  // The factories are called under `factoryMutex`, so they need not be
+  // thread-safe
+  Worker(const CaseStudy &study, std::mutex &factoryMutex) {
+    {
+      std::lock_guard<std::mutex> lock(factoryMutex);
+      flowsheet = study.factory();
+      runner = study.runnerFactory();
+    }
+    graph = std::make_unique<FlowsheetGraph>(flowsheet.blocks,
+                                             flowsheet.connectors);
+    for (const auto &variable : study.inputs) {
+      inputs.push_back(Resolve(variable, true));
+    }
+    for (const auto &variable : study.results) {
+      results.push_back(Resolve(variable, false));
+    }
+  }
+
+  Location Resolve(const Variable &variable, bool isInput) {
+    BlockHandle handle = graph->FindBlock(variable.blockId);
+    auto &block = graph->GetBlock(handle);
+    switch (variable.kind) {
+    case Variable::InputPin: {
+      Pin *pin = block.GetInputPin(variable.pin).get();
+      if (isInput) {
+        // The upstream block overwrites an inlet fed by a connector, and
+        // a linked inlet shares the upstream outlet's stream
+        for (size_t c : graph->InConnectors(handle)) {
+          if (graph->GetConnector(c).targetPin == pin) {
+            throw std::invalid_argument(
+                "Case study input " + variable.Label() +
+                " is fed by a connector; vary the upstream value instead");
+          }
+        }
+      }
+      return {pin, pin->GetSchema().GetSlot(variable.name), nullptr, ""};
+    }
+    case Variable::OutputPin: {
+      Pin *pin = block.GetOutputPin(variable.pin).get();
+      return {pin, pin->GetSchema().GetSlot(variable.name), nullptr, ""};
+    }
+    default:
+      block.GetParam(variable.name); // Throws if the parameter is missing
+      return {nullptr, 0, &block, variable.name};
+    }
+  }
+};
+
+CaseStudy::CaseStudy(const FlowsheetFactory &factory)
+    : factory(factory),
+      runnerFactory([] { return Ref<Runner>(MakeRef<WegsteinRunner>()); }) {}
+CaseStudy::CaseStudy(const FlowsheetFactory &factory,
+                     const RunnerFactory &runnerFactory)
+    : factory(factory), runnerFactory(runnerFactory) {}
+
+size_t CaseStudy::AddInput(const Variable &variable) {
+  if (!cases.empty()) {
+    throw std::logic_error("Inputs must be added before the first case");
+  }
+  if (variable.kind == Variable::OutputPin) {
+    throw std::invalid_argument("Case study input " + variable.Label() +
+                                " is an output pin");
+  }
+  inputs.push_back(variable);
+  return inputs.size() - 1;
+}
+
+size_t CaseStudy::AddResult(const Variable &variable) {
+  results.push_back(variable);
+  return results.size() - 1;
+}
+
+void CaseStudy::AddCase(const std::vector<double> &values) {
+  if (values.size() != inputs.size()) {
+    throw std::invalid_argument("Case has " + std::to_string(values.size()) +
+                                " values for " +
+                                std::to_string(inputs.size()) + " inputs");
+  }
+  cases.insert(cases.end(), values.begin(), values.end());
+}
+
+std::vector<size_t> CaseStudy::NearestNeighbourOrder() const {
+  size_t n = CaseCount();
+  size_t dims = inputs.size();
+
+  // Distances are measured on inputs scaled to their range
+  std::vector<double> scale(dims, 0.0);
+  for (size_t d = 0; d < dims; ++d) {
+    double lo = std::numeric_limits<double>::infinity();
+    double hi = -lo;
+    for (size_t c = 0; c < n; ++c) {
+      lo = std::min(lo, cases[c * dims + d]);
+      hi = std::max(hi, cases[c * dims + d]);
+    }
+    scale[d] = hi > lo ? 1.0 / (hi - lo) : 0.0;
+  }
+
+  // Greedy tour: always continue with the closest unvisited case
+  std::vector<size_t> order;
+  order.reserve(n);
+  std::vector<size_t> remaining(n);
+  for (size_t c = 0; c < n; ++c) {
+    remaining[c] = c;
+  }
+
+  size_t current = 0;
+  remaining.erase(remaining.begin());
+  order.push_back(current);
+  while (!remaining.empty()) {
+    size_t best = 0;
+    double bestDistance = std::numeric_limits<double>::infinity();
+    for (size_t r = 0; r < remaining.size(); ++r) {
+      double distance = 0.0;
+      for (size_t d = 0; d < dims; ++d) {
+        double delta = (cases[remaining[r] * dims + d] -
+                        cases[current * dims + d]) *
+                       scale[d];
+        distance += delta * delta;
+      }
+      if (distance < bestDistance) {
+        best = r;
+        bestDistance = distance;
+      }
+    }
+    current = remaining[best];
+    remaining[best] = remaining.back();
+    remaining.pop_back();
+    order.push_back(current);
+  }
+  return order;
+}
+
+CaseStudy::Results CaseStudy::Run(size_t threadCount) const {
+  size_t n = CaseCount();
+  size_t dims = inputs.size();
+
+  Results table;
+  table.caseCount = n;
+  table.columnCount = results.size();
+  table.values.assign(n * results.size(), std::nan(""));
+  table.succeeded.assign(n, 0);
+  table.errors.assign(n, "");
+  for (const auto &variable : results) {
+    table.columns.push_back(variable.Label());
+  }
+  if (n == 0) {
+    return table;
+  }
+
+  std::vector<size_t> order = NearestNeighbourOrder();
+
+  ThreadPool pool(threadCount);
+
+  // Contiguous runs of the order, a few per thread for load balance
+  size_t chunkCount = std::min(n, 4 * pool.ThreadCount());
+  size_t chunkSize = (n + chunkCount - 1) / chunkCount;
+
+  // Workers are built on first use and handed from chunk to chunk, so a
+  // new chunk starts from the state its worker was left in
+  std::mutex workerMutex;
+  std::vector<std::unique_ptr<Worker>> idleWorkers;
+  std::mutex factoryMutex;
+
+  for (size_t first = 0; first < n; first += chunkSize) {
+    size_t last = std::min(n, first + chunkSize);
+    pool.Submit([&, first, last] {
+      std::unique_ptr<Worker> worker;
+      {
+        std::lock_guard<std::mutex> lock(workerMutex);
+        if (!idleWorkers.empty()) {
+          worker = std::move(idleWorkers.back());
+          idleWorkers.pop_back();
+        }
+      }
+
+      for (size_t i = first; i < last; ++i) {
+        size_t c = order[i];
+        try {
+          if (!worker) {
+            worker = std::make_unique<Worker>(*this, factoryMutex);
+          }
+          for (size_t d = 0; d < dims; ++d) {
+            worker->inputs[d].Set(cases[c * dims + d]);
+          }
+          worker->runner->Run(*worker->graph);
+          for (size_t k = 0; k < results.size(); ++k) {
+            table.values[c * results.size() + k] = worker->results[k].Get();
+          }
+          table.succeeded[c] = 1;
+        } catch (const std::exception &e) {
+          table.errors[c] = e.what();
+          // Rebuild rather than continue from a failed state
+          worker.reset();
+        } catch (...) {
+          table.errors[c] = "Unknown error";
+          worker.reset();
+        }
+      }
+
+      if (worker) {
+        std::lock_guard<std::mutex> lock(workerMutex);
+        idleWorkers.push_back(std::move(worker));
+      }
+    });
+  }
+  pool.Wait();
+
+  return table;
+}
@@ -16,10 +16,9 @@ GetBlockConnectors(const std::vector<Ref<Connector>> &connectors,
       inConnectors.push_back(conn);
     }
   }
-  BlockConnectors out = {
-      .outConnectors = outConnectors,
-      .inConnectors = inConnectors,
-  };
+  BlockConnectors out;
+  out.outConnectors = std::move(outConnectors);
+  out.inConnectors = std::move(inConnectors);
   return out;
 }
 
@@ -32,7 +31,7 @@ void PushDataAcrossConnectors(const std::vector<Ref<CalculationBlock>> &blocks,
     auto targetId = conn->GetTargetId();
     auto targetPinId = conn->GetTargetPin();
 
-    auto it = std::find_if(blocks.begin(), blocks.end(), [&](auto block) {
+    auto it = std::find_if(blocks.begin(), blocks.end(), [&](const auto &block) {
       return block->GetId() == targetId;
     });
 
@@ -40,19 +39,49 @@ void PushDataAcrossConnectors(const std::vector<Ref<CalculationBlock>> &blocks,
       throw std::out_of_range("Could not find block with id " + targetId);
     }
 
-    auto targetBlock = *it;
+    const auto &targetBlock = *it;
     auto &originPin = block->GetOutputPin(originPinId);
     auto &targetPin = targetBlock->GetInputPin(targetPinId);
 
     // Push the data
+    Pin::CopyValues(*originPin, *targetPin);
+  }
+}
+
+namespace {
+
+void PushConnector(const CompiledConnector &conn) {
+  const double *from = conn.originPin->Data();
+  double *to = conn.targetPin->Data();
+  size_t n = conn.originPin->Size();
+  if (from == to) {
+    return; // Linked pins share the stream
+  }
+
+  if (conn.targetSlots.empty()) {
+    std::copy(from, from + n, to);
+    return;
+  }
+  for (size_t slot = 0; slot < n; ++slot) {
+    if (conn.targetSlots[slot] != StreamSchema::npos) {
+      to[conn.targetSlots[slot]] = from[slot];
+    }
+  }
+}
+
+} // namespace
+
+void PushDataAcrossConnectors(const FlowsheetGraph &graph, BlockHandle block) {
+  for (size_t c : graph.OutConnectors(block)) {
+    PushConnector(graph.GetConnector(c));
+  }
+}
 
-    for (auto &values : originPin->GetValuesMap()) {
-      auto variableName = values.first;
-      auto value = values.second;
-      targetBlock->SetInputPinValue(targetPinId, variableName, value);
-      // std::cout << "Pushing " << block->GetId() << ":" << originPinId << ":"
-      //           << variableName << " -> " << targetId << ":" << targetPinId
-      //           << ":" << variableName << "(" << value << ")" << std::endl;
+void PushDataAcrossConnectors(const FlowsheetGraph &graph, BlockHandle block,
+                              const std::vector<bool> &torn) {
+  for (size_t c : graph.OutConnectors(block)) {
+    if (!torn[c]) {
+      PushConnector(graph.GetConnector(c));
     }
   }
 }
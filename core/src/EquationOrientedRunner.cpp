@@ -0,0 +1,315 @@
+#include "EquationOrientedRunner.h"
+#include "CalculationMethod.h"
+#include "Log.h"
+#include "Profiler.h"
+#include "RunStatistics.h"
+#include "SimulationError.h"
+#include "SparseMatrix.h"
+#include "WegsteinRunner.h"
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// Global system: unknowns are pointers into pins and parameters, rows are
+// grouped per block followed by one row per connected variable
+class FlowsheetSystem {
+private:
+  struct BlockRows {
+    CalculationMethod *method;
+    size_t firstRow;
+    size_t rowCount;
+    std::vector<size_t> columns; // Unknowns the block's residuals read
+  };
+
+  struct LinkRow {
+    size_t targetColumn;
+    const double *source;
+    size_t sourceColumn; // npos when the source is fixed
+  };
+
+  static constexpr size_t npos = static_cast<size_t>(-1);
+
+  std::vector<double *> unknowns;
+  std::vector<BlockRows> blockRows;
+  std::vector<LinkRow> linkRows;
+
+  size_t AddUnknown(double *value,
+                    std::unordered_map<const double *, size_t> &columns) {
+    if (!columns.emplace(value, unknowns.size()).second) {
+      throw std::logic_error(
+          "Variable is solved for by more than one equation set");
+    }
+    unknowns.push_back(value);
+    return unknowns.size() - 1;
+  }
+
+public:
+  explicit FlowsheetSystem(const FlowsheetGraph &graph) {
+    std::unordered_map<const double *, size_t> columns;
+
+    // Block unknowns
+    size_t row = 0;
+    for (BlockHandle b = 0; b < graph.BlockCount(); ++b) {
+      const auto &method = graph.GetBlock(b).GetCalculationMethod();
+      std::vector<double *> blockUnknowns;
+      method->GetUnknowns(blockUnknowns);
+
+      BlockRows rows = {method.get(), row, blockUnknowns.size(), {}};
+      for (double *value : blockUnknowns) {
+        rows.columns.push_back(AddUnknown(value, columns));
+      }
+      row += blockUnknowns.size();
+      blockRows.push_back(std::move(rows));
+    }
+
+    // Connected input variables become unknowns tied to their source.
+    // Linked ones are their source, which the target block reads directly.
+    std::vector<std::pair<BlockHandle, const double *>> linkedReads;
+    for (size_t c = 0; c < graph.ConnectorCount(); ++c) {
+      const auto &conn = graph.GetConnector(c);
+      for (size_t slot = 0; slot < conn.originPin->Size(); ++slot) {
+        size_t targetSlot =
+            conn.targetSlots.empty() ? slot : conn.targetSlots[slot];
+        if (targetSlot == StreamSchema::npos) {
+          continue;
+        }
+        const double *source = conn.originPin->Data() + slot;
+        double *target = conn.targetPin->Data() + targetSlot;
+        if (source == target) {
+          if (conn.origin != conn.target) {
+            linkedReads.emplace_back(conn.target, source);
+          }
+          continue;
+        }
+        LinkRow link = {AddUnknown(target, columns), source, npos};
+        linkRows.push_back(link);
+
+        // The target feeds the residuals of the block it enters
+        blockRows[conn.target].columns.push_back(link.targetColumn);
+      }
+    }
+
+    for (auto &link : linkRows) {
+      auto it = columns.find(link.source);
+      if (it != columns.end()) {
+        link.sourceColumn = it->second;
+      }
+    }
+    for (const auto &[block, source] : linkedReads) {
+      auto it = columns.find(source);
+      if (it != columns.end()) {
+        blockRows[block].columns.push_back(it->second);
+      }
+    }
+  }
+
+  // Throws std::logic_error if a block cannot be solved this way
+  static void CheckSupported(const FlowsheetGraph &graph) {
+    for (BlockHandle b = 0; b < graph.BlockCount(); ++b) {
+      auto &block = graph.GetBlock(b);
+      const auto &method = block.GetCalculationMethod();
+      if (method.IsNull()) {
+        throw std::logic_error("Block " + block.GetId() +
+                               " has no calculation method");
+      }
+      if (!method->SupportsEquationOriented()) {
+        throw std::logic_error(
+            "Block " + block.GetId() + " uses method " + method->GetName() +
+            ", which has no equation-oriented residuals; choose a method "
+            "that supports them or a sequential-modular runner");
+      }
+    }
+  }
+
+  inline size_t Size() const { return unknowns.size(); }
+
+  void Gather(std::vector<double> &x) const {
+    x.resize(unknowns.size());
+    for (size_t i = 0; i < unknowns.size(); ++i) {
+      x[i] = *unknowns[i];
+    }
+  }
+
+  void Scatter(const std::vector<double> &x) const {
+    for (size_t i = 0; i < unknowns.size(); ++i) {
+      *unknowns[i] = x[i];
+    }
+  }
+
+  // Residuals at the values currently held by the pins
+  void Evaluate(std::vector<double> &r) const {
+    r.resize(unknowns.size());
+    RunStatistics::CountResidualEvaluations(blockRows.size());
+    for (const auto &rows : blockRows) {
+      rows.method->EvaluateResiduals(r.data() + rows.firstRow);
+    }
+    size_t row = blockRows.empty()
+                     ? 0
+                     : blockRows.back().firstRow + blockRows.back().rowCount;
+    for (const auto &link : linkRows) {
+      r[row++] = *unknowns[link.targetColumn] - *link.source;
+    }
+  }
+
+  // Jacobian at the current values. Block rows are differentiated by
+  // forward differences over the columns they read only; connector rows
+  // are exact.
+  SparseMatrix Jacobian(const std::vector<double> &r,
+                        double relativePerturbation) const {
+    SparseMatrix J(unknowns.size());
+    std::vector<double> perturbed;
+
+    for (const auto &rows : blockRows) {
+      perturbed.resize(rows.rowCount);
+      for (size_t column : rows.columns) {
+        double *value = unknowns[column];
+        double saved = *value;
+        double h = relativePerturbation * std::max(std::abs(saved), 1.0);
+
+        *value = saved + h;
+        RunStatistics::CountResidualEvaluations();
+        rows.method->EvaluateResiduals(perturbed.data());
+        *value = saved;
+
+        for (size_t i = 0; i < rows.rowCount; ++i) {
+          double derivative = (perturbed[i] - r[rows.firstRow + i]) / h;
+          if (derivative != 0.0) {
+            J.Add(rows.firstRow + i, column, derivative);
+          }
+        }
+      }
+    }
+
+    size_t row = blockRows.empty()
+                     ? 0
+                     : blockRows.back().firstRow + blockRows.back().rowCount;
+    for (const auto &link : linkRows) {
+      J.Add(row, link.targetColumn, 1.0);
+      if (link.sourceColumn != npos) {
+        J.Add(row, link.sourceColumn, -1.0);
+      }
+      ++row;
+    }
+
+    return J;
+  }
+
+  void UpdateDerivedValues() const {
+    for (const auto &rows : blockRows) {
+      rows.method->UpdateDerivedValues();
+    }
+  }
+};
+
+double MaxNorm(const std::vector<double> &v) {
+  double norm = 0.0;
+  for (double value : v) {
+    if (!std::isfinite(value)) {
+      return INFINITY;
+    }
+    norm = std::max(norm, std::abs(value));
+  }
+  return norm;
+}
+
+} // namespace
+
+EquationOrientedRunner::EquationOrientedRunner()
+    : initializer(MakeRef<WegsteinRunner>()) {}
+EquationOrientedRunner::EquationOrientedRunner(const Ref<Runner> &initializer)
+    : initializer(initializer) {}
+EquationOrientedRunner::EquationOrientedRunner(const Ref<Runner> &initializer,
+                                               const Options &options)
+    : initializer(initializer), options(options) {}
+
+void EquationOrientedRunner::Run(const FlowsheetGraph &graph) {
+  FlowsheetSystem::CheckSupported(graph);
+
+  // Sequential-modular pass for the initial point. It only has to get
+  // close, so a loop or block it cannot converge is not fatal here.
+  if (!initializer.IsNull()) {
+    try {
+      initializer->Run(graph);
+    } catch (const SimulationError &e) {
+      SIM_LOG(Info) << "Initializer stopped early, continuing from its "
+                       "last point: "
+                    << e.what();
+    }
+  }
+
+  // After the initializer: the tear streams it selected have their own
+  // values now and are tied to their sources by connector rows
+  FlowsheetSystem system(graph);
+
+  SIM_PROFILE_SCOPE(solveScope, "eo", "solve");
+  std::vector<double> x, r, trial, trialResiduals;
+  system.Gather(x);
+  system.Evaluate(r);
+  double norm = MaxNorm(r);
+
+  SIM_LOG(Info) << "Equation-oriented solve: " << system.Size()
+                << " unknowns";
+
+  int iteration = 0;
+  for (; iteration < options.maxIterations && norm >= options.tolerance;
+       ++iteration) {
+    RunStatistics::CountOuterIteration();
+    SIM_PROFILE_SCOPE(scope, "eo",
+                      "iteration " + std::to_string(iteration + 1));
+    SparseMatrix J = system.Jacobian(r, options.relativePerturbation);
+    for (double &value : r) {
+      value = -value;
+    }
+    std::vector<double> dx = J.Solve(r);
+
+    // Halve the step until the residual decreases
+    double lambda = 1.0;
+    double trialNorm = INFINITY;
+    for (int halving = 0; halving < 20; ++halving, lambda *= 0.5) {
+      trial = x;
+      for (size_t i = 0; i < x.size(); ++i) {
+        trial[i] += lambda * dx[i];
+      }
+      system.Scatter(trial);
+      system.Evaluate(trialResiduals);
+      trialNorm = MaxNorm(trialResiduals);
+      if (trialNorm < norm) {
+        break;
+      }
+    }
+
+    if (!(trialNorm < norm)) {
+      system.Scatter(x);
+      std::ostringstream message;
+      message << "Equation-oriented solve: Newton step failed to reduce the "
+                 "residual "
+              << norm << " in iteration " << (iteration + 1);
+      throw ConvergenceError(message.str());
+    }
+
+    x.swap(trial);
+    r.swap(trialResiduals);
+    norm = trialNorm;
+    SIM_PROFILE(scope.SetResidual(norm));
+  }
+
+  if (!(norm < options.tolerance)) {
+    std::ostringstream message;
+    message << "Equation-oriented solve did not converge: residual " << norm
+            << " after " << iteration << " iterations";
+    throw ConvergenceError(message.str());
+  }
+  SIM_PROFILE(solveScope.SetIterations(iteration));
+  SIM_PROFILE(solveScope.SetResidual(norm));
+  SIM_PROFILE(solveScope.SetStatus("converged"));
+  SIM_LOG(Info) << "Equation-oriented solve converged after " << iteration
+                << " Newton iterations";
+
+  system.UpdateDerivedValues();
+}
@@ -0,0 +1,80 @@
+#include "FlowsheetArena.h"
+#include "Log.h"
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+thread_local FlowsheetArena *FlowsheetArena::current = nullptr;
+
+FlowsheetArena::FlowsheetArena(size_t chunkSize) : chunkSize(chunkSize) {}
+
+Ref<FlowsheetArena> FlowsheetArena::Create(size_t chunkSize) {
+  Ref<FlowsheetArena> arena = MakeRef<FlowsheetArena>(chunkSize);
+  arena->self = arena;
+  return arena;
+}
+
+FlowsheetArena::~FlowsheetArena() {
+  if (liveAllocations.load(std::memory_order_acquire) != 0) {
+    // Freeing the chunks would leave the objects still in use dangling
+    SIM_LOG(Error) << "FlowsheetArena destroyed while " << LiveAllocations()
+                   << " allocations are in use; leaking "
+                   << chunks.size() << " chunks";
+    return;
+  }
+  for (const auto &chunk : chunks) {
+    ::operator delete(chunk.data);
+  }
+}
+
+void FlowsheetArena::AddChunk(size_t minimumSize) {
+  size_t size = std::max(chunkSize, minimumSize);
+  auto *data = static_cast<unsigned char *>(::operator new(size));
+  chunks.push_back({data, size});
+  next = data;
+  end = data + size;
+}
+
+void *FlowsheetArena::do_allocate(size_t bytes, size_t alignment) {
+  auto aligned = [&] {
+    auto address = reinterpret_cast<uintptr_t>(next);
+    return next + ((alignment - address % alignment) % alignment);
+  };
+  unsigned char *start = next ? aligned() : nullptr;
+  if (!start || bytes > static_cast<size_t>(end - start)) {
+    // Objects larger than a chunk get one of their own
+    AddChunk(bytes + alignment);
+    start = aligned();
+  }
+  bytesAllocated += start + bytes - next;
+  next = start + bytes;
+  liveAllocations.fetch_add(1, std::memory_order_relaxed);
+  return start;
+}
+
+void FlowsheetArena::do_deallocate(void *, size_t, size_t) {
+  liveAllocations.fetch_sub(1, std::memory_order_release);
+}
+
+std::pmr::memory_resource *FlowsheetArena::CurrentResource() {
+  if (current) {
+    return current;
+  }
+  return std::pmr::get_default_resource();
+}
+
+void FlowsheetArena::Reset() {
+  if (liveAllocations.load(std::memory_order_acquire) != 0) {
+    throw std::logic_error("FlowsheetArena reset while " +
+                           std::to_string(LiveAllocations()) +
+                           " allocations are in use");
+  }
+  for (size_t i = 1; i < chunks.size(); ++i) {
+    ::operator delete(chunks[i].data);
+  }
+  chunks.resize(std::min<size_t>(chunks.size(), 1));
+  next = chunks.empty() ? nullptr : chunks.front().data;
+  end = chunks.empty() ? nullptr : next + chunks.front().size;
+  bytesAllocated = 0;
+}
@@ -0,0 +1,248 @@
+#include "FlowsheetGraph.h"
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <stdexcept>
+#include <unordered_set>
+#include <utility>
+
+namespace {
+
+// Builds CSR offsets/edges from a per-connector block key
+void BuildAdjacency(size_t blockCount, const std::vector<size_t> &keys,
+                    std::vector<size_t> &offsets, std::vector<size_t> &edges) {
+  offsets.assign(blockCount + 1, 0);
+  for (size_t key : keys) {
+    ++offsets[key + 1];
+  }
+  for (size_t b = 0; b < blockCount; ++b) {
+    offsets[b + 1] += offsets[b];
+  }
+
+  edges.resize(keys.size());
+  std::vector<size_t> cursor(offsets.begin(), offsets.end() - 1);
+  for (size_t c = 0; c < keys.size(); ++c) {
+    edges[cursor[keys[c]]++] = c;
+  }
+}
+
+} // namespace
+
+FlowsheetGraph::FlowsheetGraph(
+    const std::vector<Ref<CalculationBlock>> &blocks,
+    const std::vector<Ref<Connector>> &connectors)
+    : blocks(blocks) {
+  this->handles.reserve(blocks.size());
+  for (BlockHandle b = 0; b < blocks.size(); ++b) {
+    if (!this->handles.emplace(blocks[b]->GetId(), b).second) {
+      throw std::invalid_argument("Duplicate block id " + blocks[b]->GetId());
+    }
+  }
+
+  std::vector<size_t> origins;
+  std::vector<size_t> targets;
+  origins.reserve(connectors.size());
+  targets.reserve(connectors.size());
+  this->connectors.reserve(connectors.size());
+
+  // Each input pin may have one source, so data pushes never race
+  std::unordered_set<const Pin *> fedPins;
+
+  for (auto &conn : connectors) {
+    BlockHandle origin = FindBlock(conn->GetOriginId());
+    BlockHandle target = FindBlock(conn->GetTargetId());
+
+    CompiledConnector compiled;
+    compiled.connector = conn;
+    compiled.origin = origin;
+    compiled.target = target;
+    compiled.originPin =
+        blocks[origin]->GetOutputPin(conn->GetOriginPin()).get();
+    compiled.targetPin =
+        blocks[target]->GetInputPin(conn->GetTargetPin()).get();
+    compiled.tear = conn->IsTearStream();
+
+    const auto &originSchema = compiled.originPin->GetSchema();
+    const auto &targetSchema = compiled.targetPin->GetSchema();
+    if (&originSchema != &targetSchema) {
+      for (size_t slot = 0; slot < originSchema.Size(); ++slot) {
+        compiled.targetSlots.push_back(
+            targetSchema.FindSlot(originSchema.GetVariableName(slot)));
+      }
+    }
+
+    if (!fedPins.insert(compiled.targetPin).second) {
+      throw std::invalid_argument("Input pin " + conn->GetTargetId() + ":" +
+                                  conn->GetTargetPin() +
+                                  " is fed by more than one connector");
+    }
+
+    this->connectors.push_back(std::move(compiled));
+    origins.push_back(origin);
+    targets.push_back(target);
+  }
+
+  BuildAdjacency(blocks.size(), origins, this->outOffsets, this->outEdges);
+  BuildAdjacency(blocks.size(), targets, this->inOffsets, this->inEdges);
+
+  // Last, so a flowsheet that fails to compile is left unlinked
+  for (auto &compiled : this->connectors) {
+    const auto &method = blocks[compiled.target]->GetCalculationMethod();
+    bool written =
+        method && method->WritesInput(compiled.connector->GetTargetPin());
+    if (!compiled.tear && !written && compiled.targetSlots.empty() &&
+        !compiled.targetPin->IsLinkedTo(*compiled.originPin)) {
+      compiled.targetPin->Link(*compiled.originPin);
+      this->linkedPins.push_back(compiled.targetPin);
+    }
+  }
+}
+
+FlowsheetGraph::~FlowsheetGraph() {
+  for (Pin *pin : this->linkedPins) {
+    pin->Unlink();
+  }
+}
+
+BlockHandle FlowsheetGraph::FindBlock(const std::string &blockId) const {
+  auto it = this->handles.find(blockId);
+  if (it == this->handles.end()) {
+    throw std::out_of_range("Could not find block with id " + blockId);
+  }
+  return it->second;
+}
+
+std::vector<FlowsheetComponent> FlowsheetGraph::Partition() const {
+  // Iterative Tarjan: components are found sinks first
+  const size_t UNVISITED = static_cast<size_t>(-1);
+  size_t n = BlockCount();
+  std::vector<size_t> index(n, UNVISITED);
+  std::vector<size_t> lowLink(n, 0);
+  std::vector<bool> onStack(n, false);
+  std::vector<BlockHandle> stack;
+  std::vector<size_t> componentOf(n, 0);
+  std::vector<FlowsheetComponent> components;
+  size_t counter = 0;
+
+  // DFS frame: block and position in its out-connector list
+  std::vector<std::pair<BlockHandle, size_t>> frames;
+
+  for (BlockHandle root = 0; root < n; ++root) {
+    if (index[root] != UNVISITED) {
+      continue;
+    }
+    frames.emplace_back(root, 0);
+    index[root] = lowLink[root] = counter++;
+    stack.push_back(root);
+    onStack[root] = true;
+
+    while (!frames.empty()) {
+      auto &[block, position] = frames.back();
+      IndexRange out = OutConnectors(block);
+
+      if (position < out.size()) {
+        BlockHandle next = this->connectors[out.begin()[position++]].target;
+        if (index[next] == UNVISITED) {
+          index[next] = lowLink[next] = counter++;
+          stack.push_back(next);
+          onStack[next] = true;
+          frames.emplace_back(next, 0);
+        } else if (onStack[next]) {
+          lowLink[block] = std::min(lowLink[block], index[next]);
+        }
+        continue;
+      }
+
+      BlockHandle finished = block;
+      frames.pop_back();
+      if (!frames.empty()) {
+        BlockHandle parent = frames.back().first;
+        lowLink[parent] = std::min(lowLink[parent], lowLink[finished]);
+      }
+
+      if (lowLink[finished] == index[finished]) {
+        FlowsheetComponent component;
+        component.cyclic = false;
+        BlockHandle member;
+        do {
+          member = stack.back();
+          stack.pop_back();
+          onStack[member] = false;
+          componentOf[member] = components.size();
+          component.blocks.push_back(member);
+        } while (member != finished);
+        std::sort(component.blocks.begin(), component.blocks.end());
+        components.push_back(std::move(component));
+      }
+    }
+  }
+
+  for (size_t c = 0; c < this->connectors.size(); ++c) {
+    const auto &conn = this->connectors[c];
+    size_t id = componentOf[conn.origin];
+    if (id == componentOf[conn.target]) {
+      components[id].connectors.push_back(c);
+      components[id].cyclic = true;
+    }
+  }
+
+  std::reverse(components.begin(), components.end());
+  return components;
+}
+
+std::vector<BlockHandle>
+FlowsheetGraph::OrderBlocks(const FlowsheetComponent &component,
+                            const std::vector<bool> &torn) const {
+  // Kahn's algorithm over the uncut internal connectors, preferring the
+  // lowest handle among ready blocks so the order is deterministic
+  std::unordered_map<BlockHandle, size_t> pending;
+  for (BlockHandle b : component.blocks) {
+    pending[b] = 0;
+  }
+  for (size_t c : component.connectors) {
+    if (!torn[c]) {
+      ++pending[this->connectors[c].target];
+    }
+  }
+
+  std::priority_queue<BlockHandle, std::vector<BlockHandle>,
+                      std::greater<BlockHandle>>
+      ready;
+  for (BlockHandle b : component.blocks) {
+    if (pending[b] == 0) {
+      ready.push(b);
+    }
+  }
+
+  std::vector<BlockHandle> order;
+  order.reserve(component.blocks.size());
+  while (order.size() < component.blocks.size()) {
+    if (ready.empty()) {
+      // Uncut cycle left: release the lowest handle still pending
+      for (BlockHandle b : component.blocks) {
+        if (pending[b] > 0) {
+          pending[b] = 0;
+          ready.push(b);
+          break;
+        }
+      }
+    }
+
+    BlockHandle block = ready.top();
+    ready.pop();
+    order.push_back(block);
+
+    for (size_t c : OutConnectors(block)) {
+      const auto &conn = this->connectors[c];
+      if (torn[c]) {
+        continue;
+      }
+      auto it = pending.find(conn.target);
+      if (it != pending.end() && it->second > 0 && --it->second == 0) {
+        ready.push(conn.target);
+      }
+    }
+  }
+
+  return order;
+}
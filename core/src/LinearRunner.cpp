@@ -1,17 +1,23 @@
 #include "LinearRunner.h"
-#include <iostream>
+#include "Log.h"
+#include "Profiler.h"
+#include "RunStatistics.h"
 
-void LinearRunner::Run(const std::vector<Ref<CalculationBlock>> &blocks,
-                       const std::vector<Ref<Connector>> &connectors) {
-  std::cout << "Pushing values..." << std::endl;
-  for (auto block : blocks) {
-    PushDataAcrossConnectors(blocks, connectors, block);
+void LinearRunner::Run(const FlowsheetGraph &graph) {
+  SIM_LOG(Debug) << "Pushing values...";
+  for (BlockHandle b = 0; b < graph.BlockCount(); ++b) {
+    PushDataAcrossConnectors(graph, b);
   }
-  std::cout << "Running..." << std::endl;
-  for (auto block : blocks) {
-    std::cout << "Calculating " << block->GetId() << std::endl;
-    block->Calculate();
-    PushDataAcrossConnectors(blocks, connectors, block);
+  SIM_LOG(Debug) << "Running...";
+  for (BlockHandle b = 0; b < graph.BlockCount(); ++b) {
+    auto &block = graph.GetBlock(b);
+    SIM_LOG(Debug) << "Calculating " << block.GetId();
+    RunStatistics::CountCalculate();
+    {
+      SIM_PROFILE_SCOPE(scope, "block", block.GetId());
+      block.Calculate();
+    }
+    PushDataAcrossConnectors(graph, b);
   }
-  std::cout << "Ended..." << std::endl;
+  SIM_LOG(Info) << "Ended...";
 };
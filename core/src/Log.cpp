@@ -0,0 +1,235 @@
+#include "Log.h"
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace Log {
+
+std::atomic<LogLevel> runtimeLevel{LogLevel::Info};
+
+namespace {
+
+constexpr size_t RingCapacity = 1024;
+// The sink thread also wakes on its own at this interval
+constexpr auto SinkInterval = std::chrono::milliseconds(10);
+
+// Single producer (the owning thread), single consumer (whoever holds the
+// drain mutex)
+struct Ring {
+  uint32_t thread;
+  std::array<Record, RingCapacity> slots;
+  std::atomic<size_t> head{0}; // Next record to drain
+  std::atomic<size_t> tail{0}; // Next slot to fill
+};
+
+void DefaultSink(const Record &record) {
+  switch (record.level) {
+  case LogLevel::Warning:
+  case LogLevel::Error:
+    std::cerr << LevelName(record.level) << ": " << record.text << '\n';
+    break;
+  default:
+    std::cout << record.text << '\n';
+  }
+}
+
+class Logger {
+private:
+  std::mutex registryMutex;
+  std::vector<std::shared_ptr<Ring>> rings;
+
+  std::mutex drainMutex; // Consumer side of all rings, and the sink
+  Sink sink = DefaultSink;
+  std::vector<Record> pending;
+
+  std::mutex wakeMutex;
+  std::condition_variable wake;
+  bool wakeRequested = false;
+  bool stopping = false;
+  std::thread worker;
+  std::atomic<bool> started{false};
+
+  void Work() {
+    while (true) {
+      bool stop;
+      {
+        std::unique_lock<std::mutex> lock(wakeMutex);
+        wake.wait_for(lock, SinkInterval,
+                      [this] { return wakeRequested || stopping; });
+        wakeRequested = false;
+        stop = stopping;
+      }
+      Drain();
+      if (stop) {
+        return;
+      }
+    }
+  }
+
+  void StartWorker() {
+    if (started.load(std::memory_order_acquire)) {
+      return;
+    }
+    std::lock_guard<std::mutex> lock(wakeMutex);
+    if (!worker.joinable() && !stopping) {
+      worker = std::thread(&Logger::Work, this);
+      started.store(true, std::memory_order_release);
+    }
+  }
+
+  void Wake() {
+    {
+      std::lock_guard<std::mutex> lock(wakeMutex);
+      wakeRequested = true;
+    }
+    wake.notify_one();
+  }
+
+  // Takes every published record out of the rings and writes them to the
+  // sink in time order. The caller holds drainMutex.
+  void DrainLocked() {
+    {
+      std::lock_guard<std::mutex> lock(registryMutex);
+      for (const auto &ring : rings) {
+        size_t head = ring->head.load(std::memory_order_relaxed);
+        size_t tail = ring->tail.load(std::memory_order_acquire);
+        for (; head != tail; ++head) {
+          pending.push_back(std::move(ring->slots[head % RingCapacity]));
+        }
+        ring->head.store(head, std::memory_order_release);
+      }
+    }
+    if (pending.empty()) {
+      return;
+    }
+
+    std::stable_sort(pending.begin(), pending.end(),
+                     [](const Record &a, const Record &b) {
+                       return a.time < b.time;
+                     });
+    for (const Record &record : pending) {
+      sink(record);
+    }
+    pending.clear();
+    std::cout.flush();
+    std::cerr.flush();
+  }
+
+public:
+  ~Logger() {
+    {
+      std::lock_guard<std::mutex> lock(wakeMutex);
+      stopping = true;
+    }
+    wake.notify_one();
+    if (worker.joinable()) {
+      worker.join();
+    }
+    Drain();
+  }
+
+  Ring &LocalRing() {
+    thread_local std::shared_ptr<Ring> ring = [this] {
+      std::lock_guard<std::mutex> lock(registryMutex);
+      auto created = std::make_shared<Ring>();
+      created->thread = static_cast<uint32_t>(rings.size());
+      rings.push_back(created);
+      return created;
+    }();
+    return *ring;
+  }
+
+  void Push(Record record) {
+    Ring &ring = LocalRing();
+    bool urgent = record.level >= LogLevel::Warning;
+    size_t tail = ring.tail.load(std::memory_order_relaxed);
+    if (tail - ring.head.load(std::memory_order_acquire) == RingCapacity) {
+      Drain();
+    }
+    record.thread = ring.thread;
+    ring.slots[tail % RingCapacity] = std::move(record);
+    ring.tail.store(tail + 1, std::memory_order_release);
+
+    StartWorker();
+    if (urgent ||
+        tail - ring.head.load(std::memory_order_relaxed) >= RingCapacity / 2) {
+      Wake();
+    }
+  }
+
+  void Drain() {
+    std::lock_guard<std::mutex> lock(drainMutex);
+    DrainLocked();
+  }
+
+  void SetSink(Sink replacement) {
+    std::lock_guard<std::mutex> lock(drainMutex);
+    DrainLocked();
+    sink = std::move(replacement);
+  }
+};
+
+Logger &Instance() {
+  static Logger logger;
+  return logger;
+}
+
+uint64_t Now() {
+  static const auto epoch = std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - epoch)
+      .count();
+}
+
+} // namespace
+
+const char *LevelName(LogLevel level) {
+  switch (level) {
+  case LogLevel::Trace:
+    return "TRACE";
+  case LogLevel::Debug:
+    return "DEBUG";
+  case LogLevel::Info:
+    return "INFO";
+  case LogLevel::Warning:
+    return "WARNING";
+  case LogLevel::Error:
+    return "ERROR";
+  case LogLevel::Off:
+    return "OFF";
+  }
+  return "";
+}
+
+LogLevel ParseLevel(const std::string &name) {
+  std::string upper = name;
+  std::transform(upper.begin(), upper.end(), upper.begin(),
+                 [](unsigned char c) { return std::toupper(c); });
+  for (LogLevel level : {LogLevel::Trace, LogLevel::Debug, LogLevel::Info,
+                         LogLevel::Warning, LogLevel::Error, LogLevel::Off}) {
+    if (upper == LevelName(level)) {
+      return level;
+    }
+  }
+  throw std::invalid_argument("Unknown log level " + name);
+}
+
+void SetSink(Sink sink) { Instance().SetSink(std::move(sink)); }
+
+void ResetSink() { Instance().SetSink(DefaultSink); }
+
+void Flush() { Instance().Drain(); }
+
+Line::~Line() {
+  Instance().Push(Record{level, 0, Now(), stream.str()});
+}
+
+} // namespace Log
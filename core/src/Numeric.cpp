@@ -1,8 +1,29 @@
 #include "Numeric.h"
+#include "Log.h"
+#include "Profiler.h"
+#include <algorithm>
 #include <cmath>
 #include <iomanip>
-#include <iostream>
 #include <stdexcept>
+#include <string>
+
+const char *to_string(SolverStatus status) {
+  switch (status) {
+  case SolverStatus::Converged:
+    return "converged";
+  case SolverStatus::MaxIterations:
+    return "iteration limit reached";
+  case SolverStatus::SingularJacobian:
+    return "singular Jacobian";
+  case SolverStatus::NonFinite:
+    return "non-finite residual";
+  case SolverStatus::LineSearchFailed:
+    return "line search failed to reduce the residual";
+  case SolverStatus::Diverged:
+    return "diverged";
+  }
+  return "unknown";
+}
 
 // Constructor with numerical Jacobian only
 NDNewtonRaphson::NDNewtonRaphson(VectorFunction f, const SolverOptions &options)
@@ -95,6 +116,18 @@ double NDNewtonRaphson::vector_norm(const std::vector<double> &v) {
   return std::sqrt(sum);
 }
 
+// True when every component of the step is below round-off relative to x
+bool NDNewtonRaphson::is_negligible(const std::vector<double> &step,
+                                    const std::vector<double> &x) const {
+  for (size_t i = 0; i < x.size(); ++i) {
+    if (!(std::abs(step[i]) <=
+          options_.step_tolerance * std::max(std::abs(x[i]), 1.0))) {
+      return false;
+    }
+  }
+  return true;
+}
+
 // Vector subtraction
 std::vector<double>
 NDNewtonRaphson::vector_subtract(const std::vector<double> &a,
@@ -106,46 +139,85 @@ NDNewtonRaphson::vector_subtract(const std::vector<double> &a,
   return result;
 }
 
+#ifdef SIM_ENABLE_PROFILING
+namespace {
+
+void annotate(Profiler::Scope &scope,
+              const NDNewtonRaphson::SolverResult &result) {
+  scope.SetIterations(result.iterations);
+  scope.SetResidual(result.residual_norm);
+  scope.SetStatus(to_string(result.status));
+}
+
+} // namespace
+#endif
+
 // Main solver function
 NDNewtonRaphson::SolverResult
 NDNewtonRaphson::solve(const std::vector<double> &initial_guess) {
+  SIM_PROFILE_SCOPE(scope, "newton", "NDNewtonRaphson");
   std::vector<double> x = initial_guess;
   size_t n = x.size();
+  if (!lower_.empty() && lower_.size() != n) {
+    throw std::invalid_argument("Bounds for " + std::to_string(lower_.size()) +
+                                " unknowns given to a system of " +
+                                std::to_string(n));
+  }
 
   SolverResult result;
-  result.solution = x;
   result.iterations = 0;
   result.converged = false;
+  result.status = SolverStatus::MaxIterations;
 
   if (options_.verbose) {
-    std::cout << "Starting Newton-Raphson solver with " << n << " variables\n";
-    std::cout << std::setprecision(10) << std::scientific;
+    SIM_LOG(Info) << "Starting Newton-Raphson solver with " << n
+                  << " variables";
   }
 
-  for (int iter = 0; iter < options_.max_iterations; ++iter) {
-    // Evaluate function at current point
-    std::vector<double> f_x = f_(x);
+  // Keep trial points within the bounds
+  auto project = [&](std::vector<double> &point) {
+    for (size_t i = 0; i < lower_.size(); ++i) {
+      point[i] = std::min(std::max(point[i], lower_[i]), upper_[i]);
+    }
+  };
 
-    // Calculate residual norm
-    result.residual_norm = vector_norm(f_x);
+  project(x);
+  std::vector<double> f_x = f_(x);
+  result.residual_norm = vector_norm(f_x);
+  double initial_norm = result.residual_norm;
+
+  if (!std::isfinite(result.residual_norm)) {
+    result.status = SolverStatus::NonFinite;
+    result.solution = x;
+    SIM_PROFILE(annotate(scope, result));
+    return result;
+  }
 
+  for (int iter = 0;; ++iter) {
     if (options_.verbose) {
-      std::cout << "Iteration " << iter
-                << ": ||f(x)|| = " << result.residual_norm << std::endl;
+      SIM_LOG(Info) << "Iteration " << iter << ": ||f(x)|| = "
+                    << std::setprecision(10) << std::scientific
+                    << result.residual_norm;
     }
 
     // Check convergence
     if (result.residual_norm < options_.tolerance) {
       result.converged = true;
+      result.status = SolverStatus::Converged;
       result.iterations = iter;
       result.solution = x;
 
       if (options_.verbose) {
-        std::cout << "Converged after " << iter << " iterations\n";
+        SIM_LOG(Info) << "Converged after " << iter << " iterations";
       }
 
+      SIM_PROFILE(annotate(scope, result));
       return result;
     }
+    if (iter == options_.max_iterations) {
+      result.iterations = iter;
+      break;
+    }
 
     // Calculate Jacobian
     std::vector<std::vector<double>> J;
@@ -161,36 +233,90 @@ NDNewtonRaphson::solve(const std::vector<double> &initial_guess) {
       neg_f_x[i] = -f_x[i];
     }
 
+    std::vector<double> delta_x;
     try {
-      std::vector<double> delta_x = solve_linear_system(J, neg_f_x);
+      delta_x = solve_linear_system(J, neg_f_x);
+    } catch (const std::runtime_error &e) {
+      if (options_.verbose) {
+        SIM_LOG(Info) << "Linear solver failed: " << e.what();
+      }
+      result.status = SolverStatus::SingularJacobian;
+      result.iterations = iter;
+      break;
+    }
 
-      // Update solution: x = x + delta_x
+    // Backtrack from the full step until ||f|| decreases sufficiently
+    double alpha = 1.0;
+    std::vector<double> trial(n), f_trial;
+    double trial_norm = 0.0;
+    bool accepted = false;
+    for (int backtrack = 0;; ++backtrack) {
       for (size_t i = 0; i < n; ++i) {
-        x[i] += delta_x[i];
+        trial[i] = x[i] + alpha * delta_x[i];
+      }
+      project(trial);
+      f_trial = f_(trial);
+      trial_norm = vector_norm(f_trial);
+
+      bool finite = std::isfinite(trial_norm);
+      if (finite &&
+          (!options_.line_search ||
+           trial_norm <= (1.0 - 1e-4 * alpha) * result.residual_norm)) {
+        accepted = true;
+        break;
       }
+      if (!options_.line_search || backtrack == options_.max_backtracks) {
+        break;
+      }
+      alpha *= 0.5;
+    }
 
-    } catch (const std::runtime_error &e) {
-      if (options_.verbose) {
-        std::cout << "Linear solver failed: " << e.what() << std::endl;
+    if (!accepted) {
+      result.status = std::isfinite(trial_norm)
+                          ? SolverStatus::LineSearchFailed
+                          : SolverStatus::NonFinite;
+      result.iterations = iter + 1;
+      if (result.status == SolverStatus::LineSearchFailed &&
+          result.residual_norm <=
+              options_.stall_factor * options_.tolerance &&
+          is_negligible(delta_x, x)) {
+        result.converged = true;
+        result.status = SolverStatus::Converged;
+        result.iterations = iter;
       }
-      result.iterations = iter;
-      result.solution = x;
-      return result;
+      break;
+    }
+
+    x.swap(trial);
+    f_x.swap(f_trial);
+    result.residual_norm = trial_norm;
+
+    if (result.residual_norm > options_.divergence_limit * initial_norm) {
+      result.status = SolverStatus::Diverged;
+      result.iterations = iter + 1;
+      break;
     }
   }
 
-  // Max iterations reached
-  result.iterations = options_.max_iterations;
   result.solution = x;
 
   if (options_.verbose) {
-    std::cout << "Maximum iterations (" << options_.max_iterations
-              << ") reached\n";
+    SIM_LOG(Info) << "Stopped: " << to_string(result.status);
   }
 
+  SIM_PROFILE(annotate(scope, result));
   return result;
 }
 
+void NDNewtonRaphson::set_bounds(const std::vector<double> &lower,
+                                 const std::vector<double> &upper) {
+  if (lower.size() != upper.size()) {
+    throw std::invalid_argument("Lower and upper bounds differ in size");
+  }
+  lower_ = lower;
+  upper_ = upper;
+}
+
 // Utility methods
 void NDNewtonRaphson::set_jacobian(JacobianFunction jacobian) {
   jacobian_ = jacobian;
@@ -0,0 +1,92 @@
+#include "ParallelRunner.h"
+#include "Log.h"
+#include "WegsteinRunner.h"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+ParallelRunner::ParallelRunner(size_t threadCount)
+    : pool(threadCount), converger(MakeRef<WegsteinRunner>()) {}
+ParallelRunner::ParallelRunner(size_t threadCount,
+                               const Ref<TearStreamRunner> &converger)
+    : pool(threadCount), converger(converger) {}
+
+void ParallelRunner::Run(const FlowsheetGraph &graph) {
+  auto components = graph.Partition();
+  size_t count = components.size();
+
+  // Dependency DAG between components
+  std::vector<size_t> componentOf(graph.BlockCount());
+  for (size_t k = 0; k < count; ++k) {
+    for (BlockHandle b : components[k].blocks) {
+      componentOf[b] = k;
+    }
+  }
+
+  std::vector<std::vector<size_t>> successors(count);
+  for (size_t c = 0; c < graph.ConnectorCount(); ++c) {
+    const auto &conn = graph.GetConnector(c);
+    size_t from = componentOf[conn.origin];
+    size_t to = componentOf[conn.target];
+    if (from != to) {
+      successors[from].push_back(to);
+    }
+  }
+
+  auto waiting = std::make_unique<std::atomic<size_t>[]>(count);
+  for (size_t k = 0; k < count; ++k) {
+    auto &next = successors[k];
+    std::sort(next.begin(), next.end());
+    next.erase(std::unique(next.begin(), next.end()), next.end());
+    for (size_t s : next) {
+      waiting[s].fetch_add(1);
+    }
+  }
+
+  std::mutex errorMutex;
+  std::exception_ptr error;
+
+  // Each task computes one component and releases the components it feeds
+  std::function<void(size_t)> schedule = [&](size_t k) {
+    pool.Submit([&, k] {
+      try {
+        const auto &component = components[k];
+        if (component.cyclic) {
+          converger->ConvergeComponent(graph, component);
+        } else {
+          converger->RunSequential(graph, component.blocks);
+        }
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(errorMutex);
+        if (!error) {
+          error = std::current_exception();
+        }
+        return;
+      }
+
+      for (size_t s : successors[k]) {
+        if (waiting[s].fetch_sub(1) == 1) {
+          schedule(s);
+        }
+      }
+    });
+  };
+
+  for (size_t k = 0; k < count; ++k) {
+    if (waiting[k].load() == 0) {
+      schedule(k);
+    }
+  }
+  pool.Wait();
+
+  if (error) {
+    std::rethrow_exception(error);
+  }
+
+  SIM_LOG(Info) << "Parallel run completed on " << pool.ThreadCount()
+                << " threads.";
+}
@@ -1,4 +1,54 @@
 #include "Pin.h"
+#include <algorithm>
+#include <stdexcept>
 
-Pin::Pin() : id("") {}
-Pin::Pin(const std::string &id) : id(id) {}
+Pin::Pin() : Pin("", StreamSchema::Empty()) {}
+Pin::Pin(const std::string &id, const StreamSchema &schema)
+    : id(id), schema(&schema), data(values) {
+  std::fill(std::begin(values), std::end(values), 0.0);
+}
+Pin::Pin(const Pin &other)
+    : id(other.id), schema(other.schema), data(values) {
+  std::copy(other.data, other.data + StreamSchema::MaxVariables, values);
+}
+
+Pin &Pin::operator=(const Pin &other) {
+  if (this != &other) {
+    this->id = other.id;
+    this->schema = other.schema;
+    std::copy(other.data, other.data + StreamSchema::MaxVariables, values);
+    this->data = values;
+  }
+  return *this;
+}
+
+void Pin::Link(Pin &source) {
+  if (source.schema != this->schema) {
+    throw std::invalid_argument("Cannot link pin " + this->id + " to pin " +
+                                source.id + " of another schema");
+  }
+  this->data = source.data;
+}
+
+void Pin::Unlink() {
+  if (IsLinked()) {
+    std::copy(data, data + Size(), values);
+    this->data = values;
+  }
+}
+
+void Pin::CopyValues(const Pin &from, Pin &to) {
+  if (from.data == to.data) {
+    return; // Linked: nothing to copy
+  }
+  if (from.schema == to.schema) {
+    std::copy(from.data, from.data + from.Size(), to.data);
+    return;
+  }
+  for (size_t slot = 0; slot < from.Size(); ++slot) {
+    size_t targetSlot = to.schema->FindSlot(from.schema->GetVariableName(slot));
+    if (targetSlot != StreamSchema::npos) {
+      to.data[targetSlot] = from.data[slot];
+    }
+  }
+}
@@ -0,0 +1,255 @@
+#include "Profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace Profiler {
+
+namespace {
+
+struct ThreadBuffer {
+  uint32_t thread;
+  std::vector<Event> events;
+};
+
+std::mutex registryMutex;
+std::vector<std::shared_ptr<ThreadBuffer>> registry;
+
+// Buffers outlive their threads, so events of finished pool threads are
+// still exported
+ThreadBuffer &LocalBuffer() {
+  thread_local std::shared_ptr<ThreadBuffer> buffer = [] {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    auto created = std::make_shared<ThreadBuffer>();
+    created->thread = static_cast<uint32_t>(registry.size());
+    registry.push_back(created);
+    return created;
+  }();
+  return *buffer;
+}
+
+double Now() {
+  static const auto epoch = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::micro>(
+             std::chrono::steady_clock::now() - epoch)
+      .count();
+}
+
+std::vector<const Event *> AllEvents() {
+  std::vector<const Event *> events;
+  std::lock_guard<std::mutex> lock(registryMutex);
+  for (const auto &buffer : registry) {
+    for (const auto &event : buffer->events) {
+      events.push_back(&event);
+    }
+  }
+  return events;
+}
+
+bool Failed(const Event &event) {
+  return event.status && std::strcmp(event.status, "converged") != 0;
+}
+
+void WriteEscaped(std::ostream &out, const std::string &text) {
+  for (char c : text) {
+    if (c == '"' || c == '\\') {
+      out << '\\';
+    }
+    out << c;
+  }
+}
+
+// JSON has no NaN or infinity
+void WriteNumber(std::ostream &out, double value) {
+  if (std::isfinite(value)) {
+    out << value;
+  } else {
+    out << "null";
+  }
+}
+
+} // namespace
+
+Scope::Scope(const char *category, std::string name)
+    : uncaughtExceptions(std::uncaught_exceptions()) {
+  event.category = category;
+  event.name = std::move(name);
+  event.phase = 'X';
+  event.start = Now();
+}
+
+Scope::~Scope() {
+  event.duration = Now() - event.start;
+  if (!event.status && std::uncaught_exceptions() > uncaughtExceptions) {
+    event.status = "failed";
+  }
+  ThreadBuffer &buffer = LocalBuffer();
+  event.thread = buffer.thread;
+  buffer.events.push_back(std::move(event));
+}
+
+void RecordCounter(const char *category, const std::string &name,
+                   double value) {
+  ThreadBuffer &buffer = LocalBuffer();
+  Event event;
+  event.category = category;
+  event.name = name;
+  event.phase = 'C';
+  event.thread = buffer.thread;
+  event.start = Now();
+  event.duration = 0.0;
+  event.value = value;
+  event.hasValue = true;
+  buffer.events.push_back(std::move(event));
+}
+
+void PrintSummary(std::ostream &out, size_t maxBlocks) {
+  if (!Enabled) {
+    out << "Profiling is disabled; build with -DSIM_ENABLE_PROFILING=ON"
+        << std::endl;
+    return;
+  }
+
+  struct Totals {
+    size_t count = 0;
+    double time = 0.0; // µs
+    double maxTime = 0.0;
+    long iterations = 0;
+    long residualEvaluations = 0;
+    size_t failures = 0;
+
+    void Add(const Event &event) {
+      ++count;
+      time += event.duration;
+      maxTime = std::max(maxTime, event.duration);
+      iterations += std::max(event.iterations, 0);
+      residualEvaluations += std::max(event.residualEvaluations, 0);
+      failures += Failed(event);
+    }
+  };
+
+  std::map<std::string, Totals> categories;
+  std::unordered_map<std::string, Totals> blocks;
+  std::unordered_map<std::string, Totals> solves;
+  for (const Event *event : AllEvents()) {
+    if (event->phase != 'X') {
+      continue;
+    }
+    categories[event->category].Add(*event);
+    if (std::strcmp(event->category, "block") == 0) {
+      blocks[event->name].Add(*event);
+    } else if (std::strcmp(event->category, "newton") == 0) {
+      solves[event->name].Add(*event);
+    }
+  }
+
+  char line[256];
+  out << "Scopes by category (inclusive time)\n";
+  std::snprintf(line, sizeof(line), "%-12s %10s %12s %12s %10s\n", "category",
+                "count", "total ms", "iterations", "failed");
+  out << line;
+  for (const auto &[category, totals] : categories) {
+    std::snprintf(line, sizeof(line), "%-12s %10zu %12.3f %12ld %10zu\n",
+                  category.c_str(), totals.count, totals.time / 1000.0,
+                  totals.iterations, totals.failures);
+    out << line;
+  }
+
+  std::vector<std::pair<std::string, Totals>> ranked(blocks.begin(),
+                                                     blocks.end());
+  std::sort(ranked.begin(), ranked.end(), [](const auto &a, const auto &b) {
+    return a.second.time > b.second.time;
+  });
+  if (ranked.size() > maxBlocks) {
+    ranked.resize(maxBlocks);
+  }
+
+  out << "\nBlocks by Calculate() time\n";
+  std::snprintf(line, sizeof(line), "%-16s %8s %12s %10s %10s %10s %10s %8s\n",
+                "block", "calls", "total ms", "mean us", "max us",
+                "newton it", "res evals", "failed");
+  out << line;
+  for (const auto &[id, totals] : ranked) {
+    Totals solve;
+    auto found = solves.find(id);
+    if (found != solves.end()) {
+      solve = found->second;
+    }
+    std::snprintf(line, sizeof(line),
+                  "%-16s %8zu %12.3f %10.2f %10.2f %10ld %10ld %8zu\n",
+                  id.c_str(), totals.count, totals.time / 1000.0,
+                  totals.time / totals.count, totals.maxTime,
+                  solve.iterations, solve.residualEvaluations,
+                  std::max(totals.failures, solve.failures));
+    out << line;
+  }
+  out.flush();
+}
+
+void WriteChromeTrace(std::ostream &out) {
+  std::vector<const Event *> events = AllEvents();
+  std::sort(events.begin(), events.end(),
+            [](const Event *a, const Event *b) { return a->start < b->start; });
+
+  char number[32];
+  auto format = [&](double value) {
+    std::snprintf(number, sizeof(number), "%.3f", value);
+    return number;
+  };
+
+  out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+  bool first = true;
+  for (const Event *event : events) {
+    out << (first ? "\n" : ",\n") << "{\"name\": \"";
+    first = false;
+    WriteEscaped(out, event->name);
+    out << "\", \"cat\": \"" << event->category << "\", \"ph\": \""
+        << event->phase << "\", \"pid\": 1, \"tid\": " << event->thread
+        << ", \"ts\": " << format(event->start);
+    if (event->phase == 'C') {
+      out << ", \"args\": {\"value\": ";
+      WriteNumber(out, event->value);
+      out << "}}";
+      continue;
+    }
+
+    out << ", \"dur\": " << format(event->duration) << ", \"args\": {";
+    const char *separator = "";
+    if (event->iterations >= 0) {
+      out << "\"iterations\": " << event->iterations;
+      separator = ", ";
+    }
+    if (event->residualEvaluations >= 0) {
+      out << separator << "\"residual_evaluations\": "
+          << event->residualEvaluations;
+      separator = ", ";
+    }
+    if (event->hasValue) {
+      out << separator << "\"residual\": ";
+      WriteNumber(out, event->value);
+      separator = ", ";
+    }
+    if (event->status) {
+      out << separator << "\"status\": \"" << event->status << "\"";
+    }
+    out << "}}";
+  }
+  out << "\n]}\n";
+}
+
+void Clear() {
+  std::lock_guard<std::mutex> lock(registryMutex);
+  for (const auto &buffer : registry) {
+    buffer->events.clear();
+  }
+}
+
+} // namespace Profiler
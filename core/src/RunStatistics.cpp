@@ -0,0 +1,58 @@
+#include "RunStatistics.h"
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+// Counters of the running threads, and the counts of the finished ones
+struct RunStatistics::Registry {
+  std::mutex mutex;
+  std::vector<Counters *> threads;
+  RunStatistics finished;
+};
+
+RunStatistics::Registry &RunStatistics::GetRegistry() {
+  static Registry registry;
+  return registry;
+}
+
+RunStatistics::Counters::Counters() {
+  Registry &registry = GetRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  registry.threads.push_back(this);
+}
+
+RunStatistics::Counters::~Counters() {
+  Registry &registry = GetRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  registry.finished.outerIterations += outerIterations.load();
+  registry.finished.calculateCalls += calculateCalls.load();
+  registry.finished.residualEvaluations += residualEvaluations.load();
+  registry.threads.erase(
+      std::find(registry.threads.begin(), registry.threads.end(), this));
+}
+
+RunStatistics RunStatistics::Get() {
+  Registry &registry = GetRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  RunStatistics statistics = registry.finished;
+  for (const Counters *counters : registry.threads) {
+    statistics.outerIterations +=
+        counters->outerIterations.load(std::memory_order_relaxed);
+    statistics.calculateCalls +=
+        counters->calculateCalls.load(std::memory_order_relaxed);
+    statistics.residualEvaluations +=
+        counters->residualEvaluations.load(std::memory_order_relaxed);
+  }
+  return statistics;
+}
+
+void RunStatistics::Reset() {
+  Registry &registry = GetRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  registry.finished = RunStatistics();
+  for (Counters *counters : registry.threads) {
+    counters->outerIterations.store(0, std::memory_order_relaxed);
+    counters->calculateCalls.store(0, std::memory_order_relaxed);
+    counters->residualEvaluations.store(0, std::memory_order_relaxed);
+  }
+}
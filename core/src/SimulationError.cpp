@@ -0,0 +1,21 @@
+#include "SimulationError.h"
+#include <sstream>
+
+namespace {
+
+std::string Describe(const std::string &blockId, const std::string &methodName,
+                     SolverStatus status, double residualNorm) {
+  std::ostringstream message;
+  message << "Block " << blockId << " (method " << methodName
+          << ") failed: " << to_string(status)
+          << ", residual norm " << residualNorm;
+  return message.str();
+}
+
+} // namespace
+
+CalculationError::CalculationError(const std::string &blockId,
+                                   const std::string &methodName,
+                                   SolverStatus status, double residualNorm)
+    : SimulationError(Describe(blockId, methodName, status, residualNorm)),
+      blockId(blockId), methodName(methodName), status(status) {}
@@ -1,9 +1,21 @@
+#include "FlowsheetGraph.h"
+#include "Log.h"
+#include "Runner.h"
 #include "Simulator.h"
 #include "WegsteinRunner.h"
 
-Simulator::Simulator() : runner(new WegsteinRunner()) {}
+Simulator::Simulator() : runner(MakeRef<WegsteinRunner>()) {}
+Simulator::Simulator(const Ref<Runner> &runner) : runner(runner) {}
 
 void Simulator::Run(const std::vector<Ref<CalculationBlock>> &blocks,
                     const std::vector<Ref<Connector>> &connectors) {
-  this->runner->Run(blocks, connectors);
+  FlowsheetGraph graph(blocks, connectors);
+  // The run's messages come out before anything the caller prints next
+  try {
+    this->runner->Run(graph);
+  } catch (...) {
+    Log::Flush();
+    throw;
+  }
+  Log::Flush();
 }
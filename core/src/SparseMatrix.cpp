@@ -0,0 +1,88 @@
+#include "SparseMatrix.h"
+#include "SimulationError.h"
+#include <cmath>
+#include <set>
+#include <string>
+
+SparseMatrix::SparseMatrix(size_t n) : n(n), rows(n) {}
+
+size_t SparseMatrix::NonZeros() const {
+  size_t count = 0;
+  for (const auto &row : rows) {
+    count += row.size();
+  }
+  return count;
+}
+
+void SparseMatrix::Add(size_t row, size_t column, double value) {
+  rows[row][column] += value;
+}
+
+std::vector<double> SparseMatrix::Solve(std::vector<double> b) const {
+  const double PIVOT_THRESHOLD = 0.1;
+
+  auto A = rows;
+  std::vector<std::set<size_t>> columnRows(n); // Unpivoted rows per column
+  for (size_t r = 0; r < n; ++r) {
+    for (auto &[c, value] : A[r]) {
+      columnRows[c].insert(r);
+    }
+  }
+
+  std::vector<size_t> pivotRow(n);
+  for (size_t k = 0; k < n; ++k) {
+    // Threshold partial pivoting with a sparsity tie-break
+    double largest = 0.0;
+    for (size_t r : columnRows[k]) {
+      largest = std::max(largest, std::abs(A[r][k]));
+    }
+    if (largest < 1e-15) {
+      throw ConvergenceError("Singular matrix in the sparse linear solve "
+                             "(column " + std::to_string(k) + ")");
+    }
+
+    size_t p = n;
+    for (size_t r : columnRows[k]) {
+      if (std::abs(A[r][k]) >= PIVOT_THRESHOLD * largest &&
+          (p == n || A[r].size() < A[p].size())) {
+        p = r;
+      }
+    }
+    pivotRow[k] = p;
+    for (auto &[c, value] : A[p]) {
+      columnRows[c].erase(p);
+    }
+
+    // Eliminate column k from the remaining rows
+    double pivot = A[p][k];
+    std::vector<size_t> targets(columnRows[k].begin(), columnRows[k].end());
+    for (size_t r : targets) {
+      double factor = A[r][k] / pivot;
+      for (auto &[c, value] : A[p]) {
+        auto [it, inserted] = A[r].emplace(c, 0.0);
+        if (inserted) {
+          columnRows[c].insert(r);
+        }
+        it->second -= factor * value;
+      }
+      A[r].erase(k);
+      columnRows[k].erase(r);
+      b[r] -= factor * b[p];
+    }
+  }
+
+  // Back substitution: the row pivoted on column k only holds columns >= k
+  std::vector<double> x(n);
+  for (size_t k = n; k-- > 0;) {
+    const auto &row = A[pivotRow[k]];
+    double sum = b[pivotRow[k]];
+    for (auto &[c, value] : row) {
+      if (c != k) {
+        sum -= value * x[c];
+      }
+    }
+    x[k] = sum / row.at(k);
+  }
+
+  return x;
+}
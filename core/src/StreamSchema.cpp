@@ -0,0 +1,33 @@
+#include "StreamSchema.h"
+#include <stdexcept>
+
+StreamSchema::StreamSchema(const std::string &name,
+                           std::initializer_list<std::string> variables)
+    : name(name), variables(variables) {
+  if (this->variables.size() > MaxVariables) {
+    throw std::length_error("Stream schema " + name + " has too many variables");
+  }
+}
+
+size_t StreamSchema::FindSlot(const std::string &variableName) const {
+  for (size_t slot = 0; slot < this->variables.size(); ++slot) {
+    if (this->variables[slot] == variableName) {
+      return slot;
+    }
+  }
+  return npos;
+}
+
+size_t StreamSchema::GetSlot(const std::string &variableName) const {
+  size_t slot = FindSlot(variableName);
+  if (slot == npos) {
+    throw std::out_of_range("Stream " + this->name + " has no variable " +
+                            variableName);
+  }
+  return slot;
+}
+
+const StreamSchema &StreamSchema::Empty() {
+  static const StreamSchema empty("Empty", {});
+  return empty;
+}
@@ -0,0 +1,397 @@
+#include "TearSelection.h"
+#include "Log.h"
+#include <algorithm>
+#include <sstream>
+#include <map>
+#include <unordered_map>
+#include <utility>
+
+namespace {
+
+const size_t MAX_CYCLES = 5000;        // Per enumeration round
+const size_t SEARCH_BUDGET = 20000000; // Branch and bound nodes x cycles
+
+using Cycle = std::vector<size_t>; // Connector indices along the cycle
+
+// Johnson's algorithm over the uncut connectors of one component, with
+// explicit stacks so that long loops cannot overflow the call stack. Cycles
+// are found on blocks first, then expanded over parallel connectors.
+class CycleFinder {
+private:
+  const FlowsheetGraph &graph;
+  const std::vector<bool> &torn;
+
+  std::vector<BlockHandle> blocks;
+  std::vector<std::vector<size_t>> successors;     // By rank
+  std::map<std::pair<size_t, size_t>, Cycle> arcs; // Rank pair -> connectors
+
+  // A block on the current path and the next of its successors to visit
+  struct Frame {
+    size_t block;
+    size_t next;
+    bool found; // A cycle through start was found from here
+  };
+
+  size_t start = 0;
+  std::vector<bool> blocked;
+  std::vector<std::vector<size_t>> blockedBy;
+  std::vector<size_t> stack;
+  std::vector<Cycle> cycles;
+
+  bool Full() const { return cycles.size() >= MAX_CYCLES; }
+
+  void Unblock(size_t u) {
+    std::vector<size_t> pending = {u};
+    blocked[u] = false;
+    while (!pending.empty()) {
+      size_t v = pending.back();
+      pending.pop_back();
+      for (size_t w : blockedBy[v]) {
+        if (blocked[w]) {
+          blocked[w] = false;
+          pending.push_back(w);
+        }
+      }
+      blockedBy[v].clear();
+    }
+  }
+
+  void Emit() {
+    // One cycle per combination of parallel connectors, enumerated like an
+    // odometer (last arc fastest) and stopped at the cap
+    size_t length = stack.size();
+    std::vector<const Cycle *> options(length);
+    for (size_t i = 0; i < length; ++i) {
+      size_t to = i + 1 < length ? stack[i + 1] : start;
+      options[i] = &arcs.at({stack[i], to});
+    }
+
+    std::vector<size_t> choice(length, 0);
+    while (!Full()) {
+      Cycle &cycle = cycles.emplace_back(length);
+      for (size_t i = 0; i < length; ++i) {
+        cycle[i] = (*options[i])[choice[i]];
+      }
+
+      bool advanced = false;
+      for (size_t i = length; i > 0 && !advanced; --i) {
+        advanced = ++choice[i - 1] < options[i - 1]->size();
+        if (!advanced) {
+          choice[i - 1] = 0;
+        }
+      }
+      if (!advanced) {
+        return;
+      }
+    }
+  }
+
+  void Enter(std::vector<Frame> &frames, size_t v) {
+    stack.push_back(v);
+    blocked[v] = true;
+    frames.push_back({v, 0, false});
+  }
+
+  // All elementary cycles through `start` among blocks ranked from it on
+  void Circuit() {
+    std::vector<Frame> frames;
+    Enter(frames, start);
+    while (!frames.empty()) {
+      Frame &frame = frames.back();
+      const auto &next = successors[frame.block];
+      if (frame.next < next.size() && !Full()) {
+        size_t w = next[frame.next++];
+        if (w == start) {
+          Emit();
+          frame.found = true;
+        } else if (w > start && !blocked[w]) {
+          Enter(frames, w);
+        }
+        continue;
+      }
+
+      // All successors visited: leave the block
+      size_t v = frame.block;
+      bool found = frame.found;
+      if (found) {
+        Unblock(v);
+      } else {
+        for (size_t w : next) {
+          if (w >= start && std::find(blockedBy[w].begin(), blockedBy[w].end(),
+                                      v) == blockedBy[w].end()) {
+            blockedBy[w].push_back(v);
+          }
+        }
+      }
+      stack.pop_back();
+      frames.pop_back();
+      if (found && !frames.empty()) {
+        frames.back().found = true;
+      }
+    }
+  }
+
+public:
+  CycleFinder(const FlowsheetGraph &graph, const FlowsheetComponent &component,
+              const std::vector<bool> &torn)
+      : graph(graph), torn(torn), blocks(component.blocks) {
+    std::unordered_map<BlockHandle, size_t> rank;
+    for (size_t r = 0; r < blocks.size(); ++r) {
+      rank[blocks[r]] = r;
+    }
+
+    successors.resize(blocks.size());
+    for (size_t c : component.connectors) {
+      if (torn[c]) {
+        continue;
+      }
+      const auto &conn = graph.GetConnector(c);
+      size_t from = rank[conn.origin];
+      size_t to = rank[conn.target];
+      auto &options = arcs[{from, to}];
+      if (options.empty()) {
+        successors[from].push_back(to);
+      }
+      options.push_back(c);
+    }
+  }
+
+  std::vector<Cycle> FindCycles() {
+    size_t n = blocks.size();
+    for (start = 0; start < n && !Full(); ++start) {
+      blocked.assign(n, false);
+      blockedBy.assign(n, {});
+      Circuit();
+    }
+    return std::move(cycles);
+  }
+};
+
+// Minimum-weight set of connectors such that every cycle contains at least
+// one of them (cycle-matrix formulation). Greedy start, then branch and bound.
+class CoverSearch {
+private:
+  const std::vector<Cycle> &cycles;
+  std::unordered_map<size_t, size_t> weights;
+  std::unordered_map<size_t, std::vector<size_t>> cyclesOf;
+
+  std::vector<size_t> coverCount; // Chosen connectors in each cycle
+  std::unordered_map<size_t, bool> forbidden;
+  std::vector<size_t> chosen;
+  size_t nodes = 0;
+  size_t maxNodes;
+
+  std::vector<size_t> best;
+  size_t bestWeight = 0;
+
+  void Choose(size_t c, int delta) {
+    for (size_t k : cyclesOf[c]) {
+      coverCount[k] += delta;
+    }
+  }
+
+  size_t WeightOf(const std::vector<size_t> &set) {
+    size_t total = 0;
+    for (size_t c : set) {
+      total += weights[c];
+    }
+    return total;
+  }
+
+  void Greedy() {
+    std::vector<size_t> count(cycles.size(), 0);
+    size_t uncovered = cycles.size();
+    while (uncovered > 0) {
+      size_t pick = 0;
+      double pickScore = -1.0;
+      for (auto &[c, ids] : cyclesOf) {
+        size_t gain = 0;
+        for (size_t k : ids) {
+          gain += count[k] == 0;
+        }
+        double score = double(gain) / double(std::max<size_t>(weights[c], 1));
+        if (score > pickScore || (score == pickScore && c < pick)) {
+          pick = c;
+          pickScore = score;
+        }
+      }
+      best.push_back(pick);
+      for (size_t k : cyclesOf[pick]) {
+        uncovered -= count[k]++ == 0;
+      }
+    }
+
+    // Drop connectors whose cycles are all covered by others anyway
+    for (size_t i = best.size(); i-- > 0;) {
+      size_t c = best[i];
+      bool redundant = std::all_of(cyclesOf[c].begin(), cyclesOf[c].end(),
+                                   [&](size_t k) { return count[k] > 1; });
+      if (redundant) {
+        for (size_t k : cyclesOf[c]) {
+          --count[k];
+        }
+        best.erase(best.begin() + i);
+      }
+    }
+    bestWeight = WeightOf(best);
+  }
+
+  void Search(size_t weight) {
+    if (++nodes > maxNodes) {
+      return;
+    }
+
+    // Branch on the uncovered cycle with the fewest candidate connectors
+    const Cycle *target = nullptr;
+    for (size_t k = 0; k < cycles.size(); ++k) {
+      if (coverCount[k] == 0 &&
+          (!target || cycles[k].size() < target->size())) {
+        target = &cycles[k];
+      }
+    }
+    if (!target) {
+      if (weight < bestWeight) {
+        best = chosen;
+        bestWeight = weight;
+      }
+      return;
+    }
+
+    std::vector<size_t> options;
+    for (size_t c : *target) {
+      if (!forbidden[c]) {
+        options.push_back(c);
+      }
+    }
+    std::sort(options.begin(), options.end(), [&](size_t a, size_t b) {
+      if (weights[a] != weights[b]) {
+        return weights[a] < weights[b];
+      }
+      return cyclesOf[a].size() > cyclesOf[b].size();
+    });
+
+    // Every cover contains one of the options; branch i excludes options
+    // 0..i-1 so each cover is visited once
+    for (size_t i = 0; i < options.size(); ++i) {
+      size_t c = options[i];
+      if (weight + weights[c] < bestWeight) {
+        chosen.push_back(c);
+        Choose(c, 1);
+        Search(weight + weights[c]);
+        Choose(c, -1);
+        chosen.pop_back();
+      }
+      forbidden[c] = true;
+    }
+    for (size_t c : options) {
+      forbidden[c] = false;
+    }
+  }
+
+public:
+  CoverSearch(const FlowsheetGraph &graph, const std::vector<Cycle> &cycles)
+      : cycles(cycles), coverCount(cycles.size(), 0),
+        maxNodes(SEARCH_BUDGET / std::max<size_t>(cycles.size(), 1)) {
+    for (size_t k = 0; k < cycles.size(); ++k) {
+      for (size_t c : cycles[k]) {
+        auto &ids = cyclesOf[c];
+        if (ids.empty() || ids.back() != k) {
+          ids.push_back(k);
+        }
+        weights[c] = std::max<size_t>(TearVariableCount(graph.GetConnector(c)), 1);
+      }
+    }
+  }
+
+  std::vector<size_t> Solve() {
+    Greedy();
+    Search(0);
+    std::sort(best.begin(), best.end());
+    return best;
+  }
+};
+
+} // namespace
+
+size_t TearVariableCount(const CompiledConnector &conn) {
+  if (conn.targetSlots.empty()) {
+    return conn.originPin->Size();
+  }
+  return std::count_if(conn.targetSlots.begin(), conn.targetSlots.end(),
+                       [](size_t slot) { return slot != StreamSchema::npos; });
+}
+
+TearSet SelectTearStreams(const FlowsheetGraph &graph,
+                          const FlowsheetComponent &component) {
+  TearSet tears;
+  std::vector<bool> torn(graph.ConnectorCount(), false);
+
+  // Manual marks take precedence
+  for (size_t c : component.connectors) {
+    if (graph.GetConnector(c).tear) {
+      tears.connectors.push_back(c);
+    }
+  }
+
+  if (!tears.connectors.empty()) {
+    auto cycles = CycleFinder(graph, component, torn).FindCycles();
+    tears.cycleCount = cycles.size();
+    for (size_t c : tears.connectors) {
+      torn[c] = true;
+    }
+    // The uncut cycles are those the marks miss. A capped enumeration does
+    // not hold all of them; count them on the cut graph then.
+    size_t open = 0;
+    if (cycles.size() < MAX_CYCLES) {
+      open = std::count_if(cycles.begin(), cycles.end(), [&](auto &cycle) {
+        return std::none_of(cycle.begin(), cycle.end(),
+                            [&](size_t c) { return torn[c]; });
+      });
+    } else {
+      open = CycleFinder(graph, component, torn).FindCycles().size();
+    }
+    if (open > 0) {
+      SIM_LOG(Warning) << "marked tear streams leave " << open
+                       << " cycles uncut";
+    }
+  } else {
+    tears.automatic = true;
+
+    // Cycle enumeration is capped, so repeat until no cycle is left uncut
+    while (true) {
+      auto cycles = CycleFinder(graph, component, torn).FindCycles();
+      if (cycles.empty()) {
+        break;
+      }
+      tears.cycleCount += cycles.size();
+      for (size_t c : CoverSearch(graph, cycles).Solve()) {
+        torn[c] = true;
+        tears.connectors.push_back(c);
+      }
+    }
+    std::sort(tears.connectors.begin(), tears.connectors.end());
+  }
+
+  for (size_t c : tears.connectors) {
+    tears.variableCount += TearVariableCount(graph.GetConnector(c));
+  }
+  return tears;
+}
+
+std::string DescribeTearSet(const FlowsheetGraph &graph,
+                            const TearSet &tears) {
+  std::ostringstream out;
+  out << (tears.automatic ? "Selected " : "Using ") << tears.connectors.size()
+      << " tear streams (" << tears.variableCount << " variables, "
+      << tears.cycleCount << " cycles"
+      << (tears.automatic ? ", automatic" : ", marked by user") << ")";
+  for (size_t c : tears.connectors) {
+    const auto &conn = graph.GetConnector(c);
+    out << "\n  " << conn.connector->GetOriginId() << ":"
+        << conn.connector->GetOriginPin() << " -> "
+        << conn.connector->GetTargetId() << ":"
+        << conn.connector->GetTargetPin() << " (" << TearVariableCount(conn)
+        << " variables)";
+  }
+  return out.str();
+}
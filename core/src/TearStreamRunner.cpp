@@ -0,0 +1,169 @@
+#include "TearStreamRunner.h"
+#include "Connectivity.h"
+#include "Log.h"
+#include "Profiler.h"
+#include "RunStatistics.h"
+#include "SimulationError.h"
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+namespace {
+
+std::string DescribeConnector(const CompiledConnector &conn) {
+  return conn.connector->GetOriginId() + ":" +
+         conn.connector->GetOriginPin() + " -> " +
+         conn.connector->GetTargetId() + ":" + conn.connector->GetTargetPin();
+}
+
+std::string DescribeTears(const FlowsheetGraph &graph,
+                          const RecycleLoop &loop) {
+  std::string tears;
+  for (size_t c : loop.tears.connectors) {
+    tears += (tears.empty() ? "" : ", ") +
+             DescribeConnector(graph.GetConnector(c));
+  }
+  return tears;
+}
+
+} // namespace
+
+void TearStreamRunner::Run(const FlowsheetGraph &graph) {
+  // Acyclic parts of the flowsheet are calculated once, in topological
+  // order; only recycle loops are iterated
+  for (const auto &component : graph.Partition()) {
+    if (component.cyclic) {
+      ConvergeComponent(graph, component);
+    } else {
+      RunSequential(graph, component.blocks);
+    }
+  }
+
+  SIM_LOG(Info) << GetName() << " method completed.";
+}
+
+void TearStreamRunner::RunSequential(const FlowsheetGraph &graph,
+                                     const std::vector<BlockHandle> &order) {
+  for (BlockHandle b : order) {
+    RunStatistics::CountCalculate();
+    auto &block = graph.GetBlock(b);
+    {
+      SIM_PROFILE_SCOPE(scope, "block", block.GetId());
+      block.Calculate();
+    }
+    SIM_PROFILE_SCOPE(scope, "push", block.GetId());
+    PushDataAcrossConnectors(graph, b);
+  }
+}
+
+RecycleLoop TearStreamRunner::PrepareLoop(const FlowsheetGraph &graph,
+                                          const FlowsheetComponent &component) {
+  RecycleLoop loop;
+
+  // Tear connectors inside the loop: the user's marks, or a minimal set
+  // selected automatically
+  loop.tears = SelectTearStreams(graph, component);
+  loop.torn.assign(graph.ConnectorCount(), false);
+  for (size_t c : loop.tears.connectors) {
+    loop.torn[c] = true;
+  }
+
+  loop.order = graph.OrderBlocks(component, loop.torn);
+
+  SIM_LOG(Info) << "Loop of " << loop.order.size()
+                << " blocks: " << DescribeTearSet(graph, loop.tears);
+
+  for (size_t c : loop.tears.connectors) {
+    const auto &tearConn = graph.GetConnector(c);
+    // The guesses need a buffer of their own. A tear selected here, rather
+    // than marked by the user, was linked by the graph.
+    tearConn.targetPin->Unlink();
+    const double *origin = tearConn.originPin->Data();
+    double *target = tearConn.targetPin->Data();
+
+    // Enumerate each variable of the tear stream
+    for (size_t slot = 0; slot < tearConn.originPin->Size(); ++slot) {
+      size_t targetSlot =
+          tearConn.targetSlots.empty() ? slot : tearConn.targetSlots[slot];
+      if (targetSlot == StreamSchema::npos) {
+        continue;
+      }
+
+      // Seed the guess with what the origin pin holds before the first
+      // pass (user input or a previous run), or 1 where that is zero
+      double initialGuess = origin[slot] != 0.0 ? origin[slot] : 1.0;
+      target[targetSlot] = initialGuess;
+      loop.variables.source.push_back(origin + slot);
+      loop.variables.target.push_back(target + targetSlot);
+    }
+  }
+
+  return loop;
+}
+
+void TearStreamRunner::CalculateLoop(const FlowsheetGraph &graph,
+                                     const RecycleLoop &loop) {
+  RunStatistics::CountOuterIteration();
+  for (BlockHandle b : loop.order) {
+    RunStatistics::CountCalculate();
+    auto &block = graph.GetBlock(b);
+    {
+      SIM_PROFILE_SCOPE(scope, "block", block.GetId());
+      block.Calculate();
+    }
+    SIM_PROFILE_SCOPE(scope, "push", block.GetId());
+    PushDataAcrossConnectors(graph, b, loop.torn);
+  }
+}
+
+bool TearStreamRunner::IsConverged(const double *guesses,
+                                   const double *outputs, size_t n) {
+  // More strict convergence: BOTH criteria must be met (NaN never is)
+  size_t unconverged = 0;
+  for (size_t i = 0; i < n; ++i) {
+    double x = guesses[i];
+    double absError = std::abs(outputs[i] - x);
+    double relError = std::abs(x) > 1e-12 ? absError / std::abs(x) : absError;
+    unconverged += !((absError <= MAX_ABS_ERROR) & (relError <= MAX_REL_ERROR));
+  }
+  return unconverged == 0;
+}
+
+double TearStreamRunner::TearResidual(const double *guesses,
+                                      const double *outputs, size_t n) {
+  double residual = 0.0;
+  for (size_t i = 0; i < n; ++i) {
+    double x = guesses[i];
+    double absError = std::abs(outputs[i] - x);
+    residual = std::max(residual, std::abs(x) > 1e-12 ? absError / std::abs(x)
+                                                      : absError);
+  }
+  return residual;
+}
+
+std::string TearStreamRunner::LoopLabel(const FlowsheetGraph &graph,
+                                        const RecycleLoop &loop) {
+  return "loop at " + graph.GetBlock(loop.order.front()).GetId();
+}
+
+void TearStreamRunner::CheckFinite(const FlowsheetGraph &graph,
+                                   const RecycleLoop &loop,
+                                   const double *outputs, int iteration) {
+  for (size_t i = 0; i < loop.variables.Size(); ++i) {
+    if (!std::isfinite(outputs[i])) {
+      std::ostringstream message;
+      message << "Recycle loop with tear streams " << DescribeTears(graph, loop)
+              << " produced non-finite tear values in iteration "
+              << (iteration + 1);
+      throw ConvergenceError(message.str());
+    }
+  }
+}
+
+void TearStreamRunner::FailToConverge(const FlowsheetGraph &graph,
+                                      const RecycleLoop &loop) {
+  std::ostringstream message;
+  message << "Recycle loop with tear streams " << DescribeTears(graph, loop)
+          << " did not converge after " << MAX_ITERATIONS << " iterations";
+  throw ConvergenceError(message.str());
+}
@@ -0,0 +1,106 @@
+#include "ThreadPool.h"
+#include <algorithm>
+
+namespace {
+
+// Pool and worker index of the calling thread, if it is a pool worker
+thread_local const ThreadPool *currentPool = nullptr;
+thread_local size_t currentWorker = 0;
+
+} // namespace
+
+ThreadPool::ThreadPool(size_t threadCount) {
+  if (threadCount == 0) {
+    threadCount = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  for (size_t i = 0; i < threadCount; ++i) {
+    workers.push_back(std::make_unique<Worker>());
+  }
+  for (size_t i = 0; i < threadCount; ++i) {
+    threads.emplace_back([this, i] { WorkerLoop(i); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  wake.notify_all();
+  for (auto &thread : threads) {
+    thread.join();
+  }
+}
+
+void ThreadPool::Submit(Task task) {
+  size_t index = currentPool == this
+                     ? currentWorker
+                     : nextWorker.fetch_add(1) % workers.size();
+
+  pending.fetch_add(1);
+  {
+    std::lock_guard<std::mutex> lock(workers[index]->mutex);
+    workers[index]->tasks.push_back(std::move(task));
+  }
+  queued.fetch_add(1);
+
+  // Taking the lock orders this notify after a worker's predicate check
+  std::lock_guard<std::mutex> lock(mutex);
+  wake.notify_one();
+}
+
+void ThreadPool::Wait() {
+  std::unique_lock<std::mutex> lock(mutex);
+  idle.wait(lock, [this] { return pending.load() == 0; });
+}
+
+bool ThreadPool::TryPop(size_t index, Task &task) {
+  // Own deque first, newest task (best cache reuse)
+  {
+    auto &own = *workers[index];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (!own.tasks.empty()) {
+      task = std::move(own.tasks.back());
+      own.tasks.pop_back();
+      queued.fetch_sub(1);
+      return true;
+    }
+  }
+
+  // Then steal the oldest task of another worker
+  for (size_t offset = 1; offset < workers.size(); ++offset) {
+    auto &victim = *workers[(index + offset) % workers.size()];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (!victim.tasks.empty()) {
+      task = std::move(victim.tasks.front());
+      victim.tasks.pop_front();
+      queued.fetch_sub(1);
+      return true;
+    }
+  }
+  return false;
+}
+
+void ThreadPool::WorkerLoop(size_t index) {
+  currentPool = this;
+  currentWorker = index;
+
+  while (true) {
+    Task task;
+    if (TryPop(index, task)) {
+      task();
+      if (pending.fetch_sub(1) == 1) {
+        std::lock_guard<std::mutex> lock(mutex);
+        idle.notify_all();
+      }
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    wake.wait(lock, [this] { return stopping || queued.load() > 0; });
+    if (stopping && queued.load() == 0) {
+      return;
+    }
+  }
+}
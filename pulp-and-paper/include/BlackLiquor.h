@@ -1,5 +1,7 @@
 #pragma once
 #include <cmath>
+#include <cstddef>
+#include <type_traits>
 
 double h_BL(double TC, double x);
 double cp_BL(double TC, double x);
@@ -12,3 +14,131 @@ double BPR_BL(double x, double Pbar);
 
 double convectiveCoeffJohansson(double specificMassFlow,
                                 double dynamicVisosity);
+
+// Batched versions over arrays of `count` points, for case studies and
+// property profiles. They are vectorized with AVX2 / AVX-512 where the CPU
+// supports it, and every instruction set gives bit-identical results. They
+// agree with the scalar functions to within a few ulp.
+void h_BL(const double *TC, const double *x, double *out, size_t count);
+void cp_BL(const double *TC, const double *x, double *out, size_t count);
+void intCp_BL(const double *T0C, const double *TfC, const double *x,
+              double *out, size_t count);
+void density_BL(const double *TC, const double *x, double *out,
+                size_t count);
+void dynamic_viscosity_BL(const double *TC, const double *x, double *out,
+                          size_t count);
+void BPR_BL(const double *x, const double *Pbar, double *out, size_t count);
+
+namespace BlackLiquor {
+// Instruction sets the batched functions are compiled for
+enum class Isa { Scalar, AVX2, AVX512 };
+
+// Best instruction set of this CPU; it is used unless UseIsa() says otherwise
+Isa BestIsa();
+Isa ActiveIsa();
+// Throws std::invalid_argument if the CPU does not support `isa`
+void UseIsa(Isa isa);
+const char *IsaName(Isa isa);
+} // namespace BlackLiquor
+
+// Correlations templated over the number type, so they can also be
+// evaluated on Dual<N> to get exact derivatives. The double overloads
+// above are instantiations of these; integral arguments resolve to them
+// rather than to an integer instantiation.
+template <typename T>
+using BlackLiquorNumber = std::enable_if_t<!std::is_integral_v<T>, T>;
+
+template <typename T>
+BlackLiquorNumber<T> h_BL(const T &TC, const T &x) {
+  using std::exp;
+  using std::pow;
+
+  // Black liquor enthalpy calculation based on the given correlation
+  // TC = Temperature in °C
+  // x = Dry solids mass fraction (0 to 1)
+  // Returns enthalpy in kJ/kg
+
+  double B = 105.0; // kJ/kg
+  double c = 0.3;
+
+  // Base enthalpy at 80°C
+  T h_80 = 334.88 + B * (-1.0 + exp(c * x));
+
+  // Heat capacity integral from 80°C to T
+  // Term 1: 4.216(1-x) integrated from 80 to T
+  // Term 2: [1.675 + 3.31*T/1000]*x integrated from 80 to T
+  // Term 3: [4.87 + 20*T/1000]*(1-x)*x³ integrated from 80 to T
+
+  T cp_integral =
+      4.216 * (1.0 - x) * (TC - 80.0) +
+      x * (1.675 * (TC - 80.0) + 3.31 * (pow(TC, 2) - 6400.0) / 2000.0) +
+      (1.0 - x) * pow(x, 3) *
+          (4.87 * (TC - 80.0) + (pow(TC, 2) - 6400.0) / 100.0);
+
+  // Total enthalpy
+  return h_80 + cp_integral;
+}
+
+template <typename T>
+BlackLiquorNumber<T> BPR_BL(const T &x, const T &Pbar) {
+  using std::log10;
+  using std::pow;
+
+  // Boiling Point Rise calculation for black liquor
+  // Pbar = Pressure in bar
+  // x = Dry solids mass fraction (0 to 1)
+  // Returns BPR in °C
+
+  // Calculate BPR at atmospheric conditions
+  T BPR_atm = 6.173 * x - 7.48 * pow(x, 1.5) + 32.747 * pow(x, 2);
+
+  // Get saturation temperature of pure water at pressure P (in bar)
+  // Note: You'll need to implement Tsat_p function or use steam tables
+  // For now, using Antoine equation approximation for water
+  T Tsat_water;
+  if (Pbar > 0) {
+    // Antoine equation for water (pressure in bar, temperature in °C)
+    // log10(P) = 8.07131 - 1730.63/(T + 233.426)
+    // Rearranging: T = 1730.63/(8.07131 - log10(P)) - 233.426
+    Tsat_water = 1730.63 / (8.07131 - log10(Pbar)) - 233.426;
+  } else {
+    Tsat_water = 100.0; // Default to 100°C at 1 bar
+  }
+
+  // Apply pressure correction
+  T correction_factor = 1.0 + 0.6 * (Tsat_water - 100.0) / 100.0;
+
+  // Calculate final BPR
+  return BPR_atm * correction_factor;
+}
+
+template <typename T>
+BlackLiquorNumber<T> density_BL(const T &TC, const T &x) {
+  using std::pow;
+
+  // TC = Temperature in °C
+  // x = Dry solids mass fraction (0 to 1)
+  // Returns density in kg/m³
+
+  T dens_bl_25 = 997.0 + 694.0 * x;
+  T dens_bl =
+      dens_bl_25 * (1.008 - 0.237 * TC / 1000.0 - 1.94 * pow(TC / 1000.0, 2));
+
+  return dens_bl;
+}
+
+// Heat capacity function (derived from enthalpy function)
+template <typename T>
+BlackLiquorNumber<T> cp_BL(const T &TC, const T &x) {
+  using std::pow;
+
+  // Black liquor specific heat capacity
+  // TC = Temperature in °C
+  // x = Dry solids mass fraction (0 to 1)
+  // Returns heat capacity in kJ/(kg·K)
+
+  T cp = 4.216 * (1.0 - x) + x * (1.675 + 3.31 * TC / 1000.0) +
+         (1.0 - x) * pow(x, 3) * (4.87 + 20.0 * TC / 1000.0);
+
+  return cp;
+}
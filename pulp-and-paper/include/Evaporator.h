@@ -1,19 +1,83 @@
 #pragma once
 #include "CalculationBlock.h"
+#include "ResidualMethod.h"
+#include "Streams.h"
+#include "TypedBlock.h"
 #include <string>
+#include <tuple>
+#include <vector>
 
-class Evaporator : public CalculationBlock {
+struct EvaporatorLayout {
+  // Heat transfer area (m2), heat duty (kW), overall heat transfer
+  // coefficient (kW/m2K), tube diameter (m)
+  enum Param : size_t { A, Q, U, D, ParamCount };
+  // Steam and feed liquor
+  enum Input : size_t { S, F, InputCount };
+  // Vapour, concentrated liquor and condensate
+  enum Output : size_t { V, L, C, OutputCount };
+
+  static constexpr ParamInfo Params[ParamCount] = {
+      {"A", ParamInfo::Required},
+      {"Q", 0.0},
+      {"U", ParamInfo::Required},
+      {"D", 25e-3},
+  };
+  static constexpr const char *Inputs[InputCount] = {"S", "F"};
+  static constexpr const char *Outputs[OutputCount] = {"V", "L", "C"};
+  using InputStreams = std::tuple<SteamStream, LiquorStream>;
+  using OutputStreams = std::tuple<SteamStream, LiquorStream, SteamStream>;
+};
+
+class Evaporator : public TypedBlock<EvaporatorLayout> {
 public:
-  class MethodGivenOutletPressure : public CalculationMethod {
+  // Known: TF, mF, xF, xL, PV, PS, U. Unknowns: mS, A. The steam flow mS
+  // is written to S, so S is copied from the block upstream rather than
+  // linked to its outlet. Sequential-modular only: EquationOrientedRunner
+  // rejects it.
+  class MethodGivenOutletPressure : public ResidualMethod<2> {
+  private:
+    // Fixed during the solve
+    double TF, mF, xF, xL, PV, PS, U;
+    double mL, mV, TL, TV, PC, TC, TS;
+    double hS, hC, hV, hL, hF;
+
+    // Depend on the unknowns
+    Number mS, mC, Q, A;
+
+  protected:
+    void Setup(Vector &initialGuess) override;
+    void Residuals(const Unknowns &x, Unknowns &residuals) override;
+    void Store() override;
+
   public:
     MethodGivenOutletPressure(const Ref<CalculationBlock> &parent);
-    void Calculate() override;
+    bool WritesInput(const std::string &pinName) const override;
   };
 
-  class MethodGivenInletData : public CalculationMethod {
+  // Known: TF, mF, xF, PS, mS, U, A. Unknowns: ln(xL), PV
+  class MethodGivenInletData : public ResidualMethod<2> {
+  private:
+    // Fixed during the solve
+    double TF, mF, xF, PS, mS, U, A;
+    double mC, PC, TC, TS;
+    double hS, hC, hF;
+
+    // Depend on the unknowns
+    Number mL, TL, xL, mV, TV, PV, Q;
+
+  protected:
+    void Setup(Vector &initialGuess) override;
+    void Residuals(const Unknowns &x, Unknowns &residuals) override;
+    void Store() override;
+
   public:
     MethodGivenInletData(const Ref<CalculationBlock> &parent);
-    void Calculate() override;
+
+    // Unknowns: V (m, T, P), C (m, T, P), L (m, T, x)
+    inline bool SupportsEquationOriented() const override { return true; }
+    void GetUnknowns(std::vector<double *> &unknowns) override;
+    void EvaluateResiduals(double *residuals) override;
+    void UpdateDerivedValues() override;
   };
 
 private:
@@ -21,7 +85,11 @@ private:
   void SetDefaultCalculationMethod();
 
 public:
-  Evaporator(const std::string &id);
+  // Without parameters; A and U have to be set with SetParam before the
+  // block is calculated
+  explicit Evaporator(const std::string &id);
+  // Throws std::invalid_argument if A or U is missing, or a parameter is
+  // not one of the layout's
   Evaporator(const std::string &id, ParamsMap params);
   void Calculate() override;
 };
@@ -1,13 +1,133 @@
 #pragma once
+#include "Dual.h"
 #include "IF97.h"
+#include "SteamTables.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
 
 constexpr double C_TO_K = 273.16;
 
 namespace Steam {
+
+// Full IF97 formulations
+namespace Exact {
 inline double hV_p(double Pbar) { return IF97::hvap_p(Pbar * 1e5) / 1000; }
 inline double hL_p(double Pbar) { return IF97::hliq_p(Pbar * 1e5) / 1000; }
 inline double h_Tp(double TC, double Pbar) {
   return IF97::hmass_Tp(TC + C_TO_K, Pbar * 1e5) / 1000;
 }
 inline double Tsat(double Pbar) { return IF97::Tsat97(Pbar * 1e5) - C_TO_K; }
+
+// dTsat/dP in K/bar at a point (TC, Pbar) of the IF97 saturation equation
+// (region 4), which Tsat97 solves for T. Differentiates that equation
+// implicitly, so it needs no further IF97 call.
+inline double dTsat_dP(double TC, double Pbar) {
+  const double n1 = 0.11670521452767e4, n2 = -0.72421316703206e6,
+               n3 = -0.17073846940092e2, n4 = 0.12020824702470e5,
+               n5 = -0.32325550322333e7, n6 = 0.14915108613530e2,
+               n7 = -0.48232657361591e4, n9 = -0.23855557567849,
+               n10 = 0.65017534844798e3;
+  double T = TC + C_TO_K;
+  double beta = std::pow(Pbar * 0.1, 0.25); // P in MPa
+  double theta = T + n9 / (T - n10);
+
+  // G(beta, theta) = 0 along the saturation line
+  double dGdBeta = 2 * beta * (theta * theta + n1 * theta + n2) +
+                   n3 * theta * theta + n4 * theta + n5;
+  double dGdTheta = beta * beta * (2 * theta + n1) +
+                    beta * (2 * n3 * theta + n4) + 2 * n6 * theta + n7;
+  double dBetadP = beta / (4 * Pbar);
+  double dThetadT = 1 - n9 / ((T - n10) * (T - n10));
+  return -dGdBeta / dGdTheta * dBetadP / dThetadT;
+}
+} // namespace Exact
+
+// Tables selected with UseTables(), or null for exact IF97
+extern std::atomic<const SteamTables *> activeTables;
+
+inline const SteamTables *ActiveTables() {
+  return activeTables.load(std::memory_order_relaxed);
+}
+
+inline double hV_p(double Pbar) {
+  const SteamTables *tables = ActiveTables();
+  return tables ? tables->hV_p(Pbar) : Exact::hV_p(Pbar);
+}
+inline double hL_p(double Pbar) {
+  const SteamTables *tables = ActiveTables();
+  return tables ? tables->hL_p(Pbar) : Exact::hL_p(Pbar);
+}
+inline double h_Tp(double TC, double Pbar) {
+  const SteamTables *tables = ActiveTables();
+  return tables ? tables->h_Tp(TC, Pbar) : Exact::h_Tp(TC, Pbar);
+}
+inline double Tsat(double Pbar) {
+  const SteamTables *tables = ActiveTables();
+  return tables ? tables->Tsat(Pbar) : Exact::Tsat(Pbar);
+}
+
+// Dual overloads. The backends only evaluate doubles. With IF97, dTsat/dP
+// comes from the saturation equation and (dh/dT)_p from cp; the pressure
+// derivatives of the enthalpies have no IF97 counterpart and are central
+// differences (two more calls each, relative error around 1e-10). With
+// tables, every derivative is a central difference of the interpolant.
+// Derivatives are skipped when the argument does not depend on any
+// variable.
+
+// Central difference of a scalar property at x
+template <typename F> double CentralDifference(F property, double x) {
+  double h = 6e-6 * std::max(std::abs(x), 1.0); // ~cbrt(machine epsilon)
+  return (property(x + h) - property(x - h)) / (2 * h);
+}
+
+template <size_t N> Dual<N> hV_p(const Dual<N> &Pbar) {
+  double value = hV_p(Pbar.value);
+  if (Pbar.IsConstant()) {
+    return Dual<N>(value);
+  }
+  double dP = CentralDifference([](double P) { return hV_p(P); }, Pbar.value);
+  return Dual<N>::Chain(value, dP, Pbar);
+}
+
+template <size_t N> Dual<N> hL_p(const Dual<N> &Pbar) {
+  double value = hL_p(Pbar.value);
+  if (Pbar.IsConstant()) {
+    return Dual<N>(value);
+  }
+  double dP = CentralDifference([](double P) { return hL_p(P); }, Pbar.value);
+  return Dual<N>::Chain(value, dP, Pbar);
+}
+
+template <size_t N> Dual<N> Tsat(const Dual<N> &Pbar) {
+  double value = Tsat(Pbar.value);
+  if (Pbar.IsConstant()) {
+    return Dual<N>(value);
+  }
+  double dP =
+      ActiveTables()
+          ? CentralDifference([](double P) { return Tsat(P); }, Pbar.value)
+          : Exact::dTsat_dP(value, Pbar.value);
+  return Dual<N>::Chain(value, dP, Pbar);
+}
+
+template <size_t N> Dual<N> h_Tp(const Dual<N> &TC, const Dual<N> &Pbar) {
+  double value = h_Tp(TC.value, Pbar.value);
+  double dT = 0.0;
+  double dP = 0.0;
+  if (!TC.IsConstant()) {
+    if (ActiveTables()) {
+      dT = CentralDifference([&](double T) { return h_Tp(T, Pbar.value); },
+                             TC.value);
+    } else {
+      // (dh/dT)_p is the isobaric heat capacity
+      dT = IF97::cpmass_Tp(TC.value + C_TO_K, Pbar.value * 1e5) / 1000;
+    }
+  }
+  if (!Pbar.IsConstant()) {
+    dP = CentralDifference([&](double P) { return h_Tp(TC.value, P); },
+                           Pbar.value);
+  }
+  return Dual<N>::Chain(value, dT, TC, dP, Pbar);
+}
 } // namespace Steam
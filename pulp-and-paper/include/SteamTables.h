@@ -0,0 +1,103 @@
+#pragma once
+#include "Ref.h"
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Interpolated steam properties over an operating envelope, as a faster
+// alternative to evaluating IF97 on every call. Saturation properties are
+// tabulated against ln(P); superheated enthalpy on a 2-D grid of ln(P) and
+// superheat above Tsat(P). Both use cubic (Catmull-Rom) interpolation on
+// uniform grids, refined at build time until the error at every cell centre
+// is below the requested tolerance. Points outside the envelope fall back
+// to IF97.
+//
+// Units follow Steam.h: T in oC, P in bar, h in kJ/kg.
+class SteamTables {
+public:
+  struct Options {
+    double minPressure = 0.05;   // bar
+    double maxPressure = 20.0;   // bar
+    double maxSuperheat = 100.0; // K above Tsat(P)
+    double tolerance = 1e-7;     // Relative to the property value
+  };
+
+  // Largest deviation from IF97 found for each property
+  struct Deviation {
+    double Tsat = 0.0; // K
+    double hV = 0.0;   // kJ/kg
+    double hL = 0.0;   // kJ/kg
+    double h = 0.0;    // kJ/kg, superheated region
+    double maxRelative = 0.0;
+    size_t samples = 0;
+  };
+
+private:
+  Options options;
+
+  // Grids: saturation over ln(P), superheat rows over ln(P) and columns
+  // over superheat
+  size_t saturationCount = 0;
+  size_t rowCount = 0;
+  size_t columnCount = 0;
+  double logMin = 0.0;
+  double logStep = 0.0;
+  double rowStep = 0.0;
+  double superheatStep = 0.0;
+
+  // Table data: owned when built, or pointing into a mapped file
+  std::vector<double> storage;
+  const double *TsatTable = nullptr;
+  const double *hVTable = nullptr;
+  const double *hLTable = nullptr;
+  const double *hTable = nullptr; // rowCount x columnCount, row-major
+
+  void *mapping = nullptr;
+  size_t mappingSize = 0;
+
+  SteamTables() = default;
+  void BuildSaturation();
+  void BuildSuperheated();
+  void SetGrids(size_t saturationCount, size_t rowCount, size_t columnCount);
+  void AssignTables(const double *data);
+
+public:
+  // Tabulates IF97 over the default / given envelope
+  static Ref<SteamTables> Build();
+  static Ref<SteamTables> Build(const Options &options);
+
+  // Maps a file written by Save(). Throws std::runtime_error if it cannot
+  // be read, was not written by this version, or its envelope or grid
+  // sizes are invalid.
+  static Ref<SteamTables> Load(const std::string &path);
+  void Save(const std::string &path) const;
+
+  ~SteamTables();
+  SteamTables(const SteamTables &) = delete;
+  SteamTables &operator=(const SteamTables &) = delete;
+
+  double Tsat(double Pbar) const;
+  double hV_p(double Pbar) const;
+  double hL_p(double Pbar) const;
+  double h_Tp(double TC, double Pbar) const;
+
+  inline const Options &GetOptions() const { return options; }
+  inline size_t TableSize() const {
+    return 3 * saturationCount + rowCount * columnCount;
+  }
+
+  // Compares against IF97 on a lattice offset from the table nodes, with
+  // `samplesPerAxis` points along each axis of the envelope
+  Deviation Validate(size_t samplesPerAxis = 500) const;
+  void PrintValidation(const Deviation &deviation,
+                       std::ostream &out = std::cout) const;
+};
+
+namespace Steam {
+// Routes the Steam:: property functions through the given tables. Select
+// the backend before running a flowsheet, not while one is running.
+void UseTables(const Ref<SteamTables> &tables);
+// Routes them back to exact IF97 (the default)
+void UseIF97();
+} // namespace Steam
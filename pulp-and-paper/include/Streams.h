@@ -0,0 +1,15 @@
+#pragma once
+#include "StreamSchema.h"
+#include <cstddef>
+
+// Steam, vapour and condensate: mass flow, temperature (°C), pressure (bar)
+struct SteamStream {
+  enum Slot : size_t { m, T, P };
+  static const StreamSchema &Schema();
+};
+
+// Black liquor: mass flow, temperature (°C), dry solids mass fraction
+struct LiquorStream {
+  enum Slot : size_t { m, T, x };
+  static const StreamSchema &Schema();
+};
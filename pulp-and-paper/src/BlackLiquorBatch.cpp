@@ -0,0 +1,315 @@
+#include "BlackLiquor.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+// Batched black liquor correlations. Each kernel is a plain loop with no
+// library calls, so the compiler can vectorize it; it is compiled once per
+// instruction set and selected at runtime. exp and log are evaluated with
+// the branch-free versions below rather than libm, and the file is built
+// without floating-point contraction, so all instruction sets round the
+// same operations the same way and give bit-identical results.
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BL_DISPATCH 1
+#define BL_INLINE inline __attribute__((always_inline))
+#define BL_TARGET(isa) __attribute__((target(isa)))
+#else
+#define BL_DISPATCH 0
+#define BL_INLINE inline
+#endif
+
+namespace {
+
+BL_INLINE uint64_t Bits(double v) {
+  uint64_t bits;
+  std::memcpy(&bits, &v, sizeof(bits));
+  return bits;
+}
+
+BL_INLINE double FromBits(uint64_t bits) {
+  double v;
+  std::memcpy(&v, &bits, sizeof(v));
+  return v;
+}
+
+// ln(2) split so that n * ln2Hi is exact for |n| < 2048
+constexpr double ln2Hi = 6.93145751953125e-1;
+constexpr double ln2Lo = 1.42860682030941723212e-6;
+
+// exp(v) for v in [-708, 709] (clamped), within about 1 ulp. v is reduced
+// to n ln2 + r with |r| <= ln2 / 2 and exp(r) summed as a Taylor series.
+BL_INLINE double Exp(double v) {
+  v = std::min(std::max(v, -708.0), 709.0);
+
+  // Adding 1.5 * 2^52 rounds to an integer held in the low mantissa bits
+  const double shifter = 0x1.8p52;
+  double t = v * 1.4426950408889634 + shifter;
+  double n = t - shifter;
+  double r = (v - n * ln2Hi) - n * ln2Lo;
+
+  double p = 1.0 / 6227020800.0;
+  p = p * r + 1.0 / 479001600.0;
+  p = p * r + 1.0 / 39916800.0;
+  p = p * r + 1.0 / 3628800.0;
+  p = p * r + 1.0 / 362880.0;
+  p = p * r + 1.0 / 40320.0;
+  p = p * r + 1.0 / 5040.0;
+  p = p * r + 1.0 / 720.0;
+  p = p * r + 1.0 / 120.0;
+  p = p * r + 1.0 / 24.0;
+  p = p * r + 1.0 / 6.0;
+  p = p * r + 0.5;
+  p = p * r + 1.0;
+  p = p * r + 1.0;
+
+  // 2^n, built from the integer in t's mantissa
+  uint64_t k = Bits(t) - Bits(shifter);
+  return p * FromBits((k + 1023) << 52);
+}
+
+// Natural log for positive normal v, within about 1 ulp. v = 2^e m with m in
+// [sqrt(1/2), sqrt(2)), and log(m) = 2 atanh(s), s = (m - 1) / (m + 1).
+BL_INLINE double Log(double v) {
+  uint64_t bits = Bits(v);
+  // Biased exponent as a double: its bits placed in the mantissa of 2^52
+  double e = FromBits((bits >> 52) | 0x4330000000000000ull) - 0x1p52;
+  e -= 1023.0;
+  // Mantissa with the exponent of 1.0
+  double m = FromBits((bits & 0x000FFFFFFFFFFFFFull) | 0x3FF0000000000000ull);
+  bool high = m > 1.4142135623730951;
+  m = high ? 0.5 * m : m;
+  e = high ? e + 1.0 : e;
+
+  double s = (m - 1.0) / (m + 1.0);
+  double z = s * s;
+  double p = 2.0 / 23.0;
+  p = p * z + 2.0 / 21.0;
+  p = p * z + 2.0 / 19.0;
+  p = p * z + 2.0 / 17.0;
+  p = p * z + 2.0 / 15.0;
+  p = p * z + 2.0 / 13.0;
+  p = p * z + 2.0 / 11.0;
+  p = p * z + 2.0 / 9.0;
+  p = p * z + 2.0 / 7.0;
+  p = p * z + 2.0 / 5.0;
+  p = p * z + 2.0 / 3.0;
+  double logm = 2.0 * s + s * z * p;
+  return e * ln2Hi + (logm + e * ln2Lo);
+}
+
+// The correlations of BlackLiquor.h, rearranged as polynomials in T with
+// coefficients in x
+
+BL_INLINE double H(double TC, double x) {
+  double x3 = x * x * x;
+  double h80 = 334.88 + 105.0 * (Exp(0.3 * x) - 1.0);
+  double linear = 4.216 * (1.0 - x) + 1.675 * x + 4.87 * (1.0 - x) * x3;
+  double quadratic = 3.31 / 2000.0 * x + (1.0 - x) * x3 / 100.0;
+  return h80 + (TC - 80.0) * linear + (TC * TC - 6400.0) * quadratic;
+}
+
+BL_INLINE double Cp(double TC, double x) {
+  double x3 = x * x * x;
+  double constant = 4.216 * (1.0 - x) + 1.675 * x + 4.87 * (1.0 - x) * x3;
+  double slope = 3.31 / 1000.0 * x + 20.0 / 1000.0 * (1.0 - x) * x3;
+  return constant + slope * TC;
+}
+
+BL_INLINE double IntCp(double T0C, double TfC, double x) {
+  double x3 = x * x * x;
+  double linear = 4.216 * (1.0 - x) + 1.675 * x + 4.87 * (1.0 - x) * x3;
+  double quadratic = 3.31 / 2000.0 * x + (1.0 - x) * x3 / 100.0;
+  return (TfC - T0C) * linear + (TfC * TfC - T0C * T0C) * quadratic;
+}
+
+BL_INLINE double Density(double TC, double x) {
+  double t = TC / 1000.0;
+  return (997.0 + 694.0 * x) * (1.008 + t * (-0.237 - 1.94 * t));
+}
+
+BL_INLINE double DynamicViscosity(double TC, double x) {
+  double rho = Density(TC, x);
+  double TK = TC + 273.16;
+  double A = -2.4273 + x * (3.3532 + x * (3.7654 + x * -2.49));
+  double B =
+      61347000.0 + x * (-54420000.0 + x * (219150000.0 + x * 170420000.0));
+  return rho * Exp(A + B / (TK * TK * TK)) / 1000000.0;
+}
+
+BL_INLINE double BPR(double x, double Pbar) {
+  double atm = x * (6.173 + 32.747 * x) - 7.48 * x * std::sqrt(x);
+  // Antoine equation for the saturation temperature of water
+  double log10P = Log(Pbar > 0.0 ? Pbar : 1.0) * 0.43429448190325182;
+  double antoine = 1730.63 / (8.07131 - log10P) - 233.426;
+  double Tsat = Pbar > 0.0 ? antoine : 100.0;
+  return atm * (1.0 + 0.6 * (Tsat - 100.0) / 100.0);
+}
+
+// One set of array kernels per instruction set
+struct Kernels {
+  BlackLiquor::Isa isa;
+  void (*h)(const double *, const double *, double *, size_t);
+  void (*cp)(const double *, const double *, double *, size_t);
+  void (*intCp)(const double *, const double *, const double *, double *,
+                size_t);
+  void (*density)(const double *, const double *, double *, size_t);
+  void (*dynamicViscosity)(const double *, const double *, double *, size_t);
+  void (*bpr)(const double *, const double *, double *, size_t);
+};
+
+#define BL_DEFINE_KERNELS(NAME, ATTRIBUTES)                                    \
+  ATTRIBUTES void NAME##H(const double *TC, const double *x, double *out,      \
+                          size_t count) {                                      \
+    for (size_t i = 0; i < count; ++i) {                                       \
+      out[i] = H(TC[i], x[i]);                                                 \
+    }                                                                          \
+  }                                                                            \
+  ATTRIBUTES void NAME##Cp(const double *TC, const double *x, double *out,     \
+                           size_t count) {                                     \
+    for (size_t i = 0; i < count; ++i) {                                       \
+      out[i] = Cp(TC[i], x[i]);                                                \
+    }                                                                          \
+  }                                                                            \
+  ATTRIBUTES void NAME##IntCp(const double *T0C, const double *TfC,            \
+                              const double *x, double *out, size_t count) {    \
+    for (size_t i = 0; i < count; ++i) {                                       \
+      out[i] = IntCp(T0C[i], TfC[i], x[i]);                                    \
+    }                                                                          \
+  }                                                                            \
+  ATTRIBUTES void NAME##Density(const double *TC, const double *x,             \
+                                double *out, size_t count) {                   \
+    for (size_t i = 0; i < count; ++i) {                                       \
+      out[i] = Density(TC[i], x[i]);                                           \
+    }                                                                          \
+  }                                                                            \
+  ATTRIBUTES void NAME##DynamicViscosity(const double *TC, const double *x,    \
+                                         double *out, size_t count) {          \
+    for (size_t i = 0; i < count; ++i) {                                       \
+      out[i] = DynamicViscosity(TC[i], x[i]);                                  \
+    }                                                                          \
+  }                                                                            \
+  ATTRIBUTES void NAME##BPR(const double *x, const double *Pbar, double *out,  \
+                            size_t count) {                                    \
+    for (size_t i = 0; i < count; ++i) {                                       \
+      out[i] = BPR(x[i], Pbar[i]);                                             \
+    }                                                                          \
+  }                                                                            \
+  const Kernels NAME##Kernels = {                                              \
+      BlackLiquor::Isa::NAME, NAME##H,       NAME##Cp,                         \
+      NAME##IntCp,            NAME##Density, NAME##DynamicViscosity,           \
+      NAME##BPR};
+
+// Scalar is the baseline for the target, which the compiler may still
+// vectorize (e.g. with SSE2)
+BL_DEFINE_KERNELS(Scalar, )
+#if BL_DISPATCH
+BL_DEFINE_KERNELS(AVX2, BL_TARGET("avx2"))
+BL_DEFINE_KERNELS(AVX512, BL_TARGET("avx512f"))
+#endif
+
+const Kernels &KernelsFor(BlackLiquor::Isa isa) {
+  switch (isa) {
+#if BL_DISPATCH
+  case BlackLiquor::Isa::AVX512:
+    return AVX512Kernels;
+  case BlackLiquor::Isa::AVX2:
+    return AVX2Kernels;
+#endif
+  default:
+    return ScalarKernels;
+  }
+}
+
+bool Supports(BlackLiquor::Isa isa) {
+  switch (isa) {
+  case BlackLiquor::Isa::Scalar:
+    return true;
+#if BL_DISPATCH
+  case BlackLiquor::Isa::AVX2:
+    return __builtin_cpu_supports("avx2");
+  case BlackLiquor::Isa::AVX512:
+    return __builtin_cpu_supports("avx512f");
+#endif
+  default:
+    return false;
+  }
+}
+
+std::atomic<const Kernels *> activeKernels{nullptr};
+
+const Kernels &Active() {
+  const Kernels *kernels = activeKernels.load(std::memory_order_acquire);
+  if (!kernels) {
+    kernels = &KernelsFor(BlackLiquor::BestIsa());
+    activeKernels.store(kernels, std::memory_order_release);
+  }
+  return *kernels;
+}
+
+} // namespace
+
+void h_BL(const double *TC, const double *x, double *out, size_t count) {
+  Active().h(TC, x, out, count);
+}
+
+void cp_BL(const double *TC, const double *x, double *out, size_t count) {
+  Active().cp(TC, x, out, count);
+}
+
+void intCp_BL(const double *T0C, const double *TfC, const double *x,
+              double *out, size_t count) {
+  Active().intCp(T0C, TfC, x, out, count);
+}
+
+void density_BL(const double *TC, const double *x, double *out,
+                size_t count) {
+  Active().density(TC, x, out, count);
+}
+
+void dynamic_viscosity_BL(const double *TC, const double *x, double *out,
+                          size_t count) {
+  Active().dynamicViscosity(TC, x, out, count);
+}
+
+void BPR_BL(const double *x, const double *Pbar, double *out, size_t count) {
+  Active().bpr(x, Pbar, out, count);
+}
+
+namespace BlackLiquor {
+
+Isa BestIsa() {
+  if (Supports(Isa::AVX512)) {
+    return Isa::AVX512;
+  }
+  if (Supports(Isa::AVX2)) {
+    return Isa::AVX2;
+  }
+  return Isa::Scalar;
+}
+
+Isa ActiveIsa() { return Active().isa; }
+
+void UseIsa(Isa isa) {
+  if (!Supports(isa)) {
+    throw std::invalid_argument(std::string("Instruction set ") +
+                                IsaName(isa) + " is not supported");
+  }
+  activeKernels.store(&KernelsFor(isa), std::memory_order_release);
+}
+
+const char *IsaName(Isa isa) {
+  switch (isa) {
+  case Isa::AVX2:
+    return "AVX2";
+  case Isa::AVX512:
+    return "AVX-512";
+  default:
+    return "scalar";
+  }
+}
+
+} // namespace BlackLiquor
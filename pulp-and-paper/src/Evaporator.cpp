@@ -1,50 +1,56 @@
 #include "Evaporator.h"
 #include "BlackLiquor.h"
 #include "CalculationBlock.h"
+#include "Dual.h"
+#include "Log.h"
 #include "Numeric.h"
 #include "Steam.h"
-#include <iostream>
+#include "Streams.h"
+#include <stdexcept>
+
+namespace {
+
+// The methods read the block through its typed layout
+const Ref<CalculationBlock> &
+RequireEvaporator(const Ref<CalculationBlock> &parent) {
+  if (!dynamic_cast<Evaporator *>(parent.get())) {
+    throw std::invalid_argument("Evaporator method set on block " +
+                                (parent.IsNull() ? "null" : parent->GetId()) +
+                                ", which is not an evaporator");
+  }
+  return parent;
+}
 
-Evaporator::Evaporator(const std::string &id) : CalculationBlock(id) {
+} // namespace
+
+Evaporator::Evaporator(const std::string &id) : TypedBlock(id) {
   InitializePins();
 }
+
 Evaporator::Evaporator(const std::string &id, ParamsMap params)
-    : CalculationBlock(id, params) {
+    : TypedBlock(id, std::move(params)) {
   InitializePins();
 }
 
 void Evaporator::InitializePins() {
-  auto &S = AddInputPin("S");
-  S->SetValue("m", 1);
-  S->SetValue("P", 1);
-  S->SetValue("T", 25);
-
-  auto &F = AddInputPin("F");
-  F->SetValue("m", 1);
-  F->SetValue("T", 25);
-  F->SetValue("x", 0.1);
-
-  auto &V = AddOutputPin("V");
-  V->SetValue("m", 1);
-  V->SetValue("P", 1);
-  V->SetValue("T", 25);
-
-  auto &L = AddOutputPin("L");
-  L->SetValue("m", 1);
-  L->SetValue("T", 25);
-  L->SetValue("x", 0.1);
-
-  auto &C = AddOutputPin("C");
-  C->SetValue("m", 1);
-  C->SetValue("P", 1);
-  C->SetValue("T", 25);
+  for (auto steam : {In<Input::S>(), Out<Output::V>(), Out<Output::C>()}) {
+    steam.Set(SteamStream::m, 1);
+    steam.Set(SteamStream::P, 1);
+    steam.Set(SteamStream::T, 25);
+  }
+  for (auto liquor : {In<Input::F>(), Out<Output::L>()}) {
+    liquor.Set(LiquorStream::m, 1);
+    liquor.Set(LiquorStream::T, 25);
+    liquor.Set(LiquorStream::x, 0.1);
+  }
 }
 
 void Evaporator::Calculate() {
   if (this->method.IsNull()) {
-    std::cout << "ERROR: No method set!" << std::endl;
+    SIM_LOG(Error) << "No method set!";
     return;
   }
+  CheckParams();
   this->method->Calculate();
 }
 
@@ -52,9 +58,17 @@ void Evaporator::Calculate() {
 
 Evaporator::MethodGivenOutletPressure::MethodGivenOutletPressure(
     const Ref<CalculationBlock> &parent)
-    : CalculationMethod(parent, "OutletPressureKnown") {}
+    : ResidualMethod(RequireEvaporator(parent), "OutletPressureKnown") {
+  // Steam flow and area cannot be negative
+  lowerBounds = {0, 0};
+}
 
-void Evaporator::MethodGivenOutletPressure::Calculate() {
+bool Evaporator::MethodGivenOutletPressure::WritesInput(
+    const std::string &pinName) const {
+  return pinName == EvaporatorLayout::Inputs[Input::S];
+}
+
+void Evaporator::MethodGivenOutletPressure::Setup(Vector &initialGuess) {
   // Assuming T in oC and P in bar
 
   // Assuming 18 variables in total:
@@ -65,136 +79,105 @@ void Evaporator::MethodGivenOutletPressure::Calculate() {
   // C: m, T, P
   // A, Q, U
 
-  const auto &S = parent->GetInputPin("S");
-  const auto &F = parent->GetInputPin("F");
-  const auto &V = parent->GetOutputPin("V");
-  const auto &L = parent->GetOutputPin("L");
-  const auto &C = parent->GetOutputPin("C");
-
-  // Taking as known:
-  // - TF
-  // - mF
-  // - xF
-  // - xL
-  // - PV
-  // - PS
-  // - U
-
-  double TF = F->GetValue("T");
-  double mF = F->GetValue("m");
-  double xF = F->GetValue("x");
-  double xL = L->GetValue("x");
-  double PV = V->GetValue("P");
-  double PS = S->GetValue("P");
-  double U = parent->GetParam("U");
-
-  // Initial estimates
-  double mL = 0;
-  double TL = 25;
-
-  double mS = 0;
-  double TS = 25;
-
-  double mC = 0;
-  double TC = 25;
-  double PC = 1;
-
-  double mV = 0;
-  double TV = 25;
-
-  double Q = 0;
-  double A = 0;
-
-  auto system = [&](std::vector<double> x) {
-    mS = x[0];
-    A = x[1];
-
-    // Simple equations
-
-    // --- Mass balances
-
-    mC = mS;
-    mL = mF * xF / xL;
-    mV = mF - mL;
-
-    // --- Thermodynamics
-
-    TL = Steam::Tsat(PV) + BPR_BL(xL, PV);
-    TV = TL;
-    PC = PS;
-    TC = Steam::Tsat(PC);
-    TS = Steam::Tsat(PS);
-
-    // --- Energy balances
-
-    // std::cout << "EB" << std::endl;
-    Q = U * A * (TS - TL);
-
-    double hS = Steam::hV_p(PS);
-    double hC = Steam::hL_p(PC);
-    double hV = Steam::h_Tp(TV, PV);
-    double hL = h_BL(TL, xL);
-    double hF = h_BL(TF, xF);
-
-    // std::cout << "=============" << std::endl;
-    // std::cout << "hS " << hS << std::endl;
-    // std::cout << "hC " << hC << std::endl;
-    // std::cout << "hF " << hF << std::endl;
-    // std::cout << "hL " << hL << std::endl;
-    // std::cout << "hV " << hV << std::endl;
-    // std::cout << "PS " << PS << std::endl;
-    // std::cout << "TS " << TS << std::endl;
-    // std::cout << "TL " << TL << std::endl;
-    // std::cout << "TF " << TF << std::endl;
-    // std::cout << "Q " << Q << std::endl;
-    // std::cout << "A " << A << std::endl;
-    // std::cout << "U " << U << std::endl;
-
-    double ebSteamSide = hS * mS - mC * hC - Q;
-    double ebLiquorSide = hF * mF + Q - mL * hL - mV * hV;
-
-    std::vector<double> out = {ebSteamSide, ebLiquorSide};
-    return out;
-  };
-
-  NDNewtonRaphson::SolverOptions options;
-  options.max_iterations = 100;
-  options.verbose = false;
-  options.h = 1e-6;
-
-  NDNewtonRaphson solver(system, options);
-  auto result = solver.solve({0, 0});
-  auto out = result.solution;
-
-  parent->SetOutputPinValue("V", "m", mV);
-  parent->SetOutputPinValue("V", "T", TV);
-  parent->SetOutputPinValue("V", "P", PV);
-
-  parent->SetOutputPinValue("C", "m", mC);
-  parent->SetOutputPinValue("C", "T", TC);
-  parent->SetOutputPinValue("C", "P", PC);
-
-  parent->SetOutputPinValue("L", "m", mL);
-  parent->SetOutputPinValue("L", "T", TL);
-  parent->SetOutputPinValue("L", "x", xL);
-
-  parent->SetInputPinValue("S", "m", mS);
-  parent->SetInputPinValue("S", "T", TS);
-  parent->SetInputPinValue("S", "P", PS);
-
-  parent->SetInputPinValue("F", "m", mF);
-  parent->SetInputPinValue("F", "T", TF);
-  parent->SetInputPinValue("F", "x", xF);
+  auto &block = ParentAs<Evaporator>();
+  auto S = block.In<Input::S>();
+  auto F = block.In<Input::F>();
+  auto V = block.Out<Output::V>();
+  auto L = block.Out<Output::L>();
+
+  TF = F.Get(LiquorStream::T);
+  mF = F.Get(LiquorStream::m);
+  xF = F.Get(LiquorStream::x);
+  xL = L.Get(LiquorStream::x);
+  PV = V.Get(SteamStream::P);
+  PS = S.Get(SteamStream::P);
+  U = block.GetParam(Param::U);
+  WatchInputs({TF, mF, xF, xL, PV, PS, U});
+
+  // With xL and PV known, everything but the energy balances is fixed
+
+  // --- Mass balances
+
+  mL = mF * xF / xL;
+  mV = mF - mL;
+
+  // --- Thermodynamics
+
+  TL = Steam::Tsat(PV) + BPR_BL(xL, PV);
+  TV = TL;
+  PC = PS;
+  TC = Steam::Tsat(PC);
+  TS = Steam::Tsat(PS);
+
+  hS = Steam::hV_p(PS);
+  hC = Steam::hL_p(PC);
+  hV = Steam::h_Tp(TV, PV);
+  hL = h_BL(TL, xL);
+  hF = h_BL(TF, xF);
+
+  // Initial estimates: mS, A
+  initialGuess = {0, 0};
+}
+
+void Evaporator::MethodGivenOutletPressure::Residuals(const Unknowns &x,
+                                                      Unknowns &residuals) {
+  mS = x[0];
+  A = x[1];
+
+  mC = mS;
+
+  // --- Energy balances
+
+  Q = U * A * (TS - TL);
+
+  Number ebSteamSide = hS * mS - mC * hC - Q;
+  Number ebLiquorSide = hF * mF + Q - mL * hL - mV * hV;
+
+  residuals = {ebSteamSide, ebLiquorSide};
+}
+
+void Evaporator::MethodGivenOutletPressure::Store() {
+  auto &block = ParentAs<Evaporator>();
+  auto S = block.In<Input::S>();
+  auto F = block.In<Input::F>();
+  auto V = block.Out<Output::V>();
+  auto L = block.Out<Output::L>();
+  auto C = block.Out<Output::C>();
+
+  V.Set(SteamStream::m, mV);
+  V.Set(SteamStream::T, TV);
+  V.Set(SteamStream::P, PV);
+
+  C.Set(SteamStream::m, mC.value);
+  C.Set(SteamStream::T, TC);
+  C.Set(SteamStream::P, PC);
+
+  L.Set(LiquorStream::m, mL);
+  L.Set(LiquorStream::T, TL);
+  L.Set(LiquorStream::x, xL);
+
+  // A linked inlet is the outlet of the block upstream, which owns it.
+  // FlowsheetGraph leaves S unlinked for this method (WritesInput).
+  if (!S.IsLinked()) {
+    S.Set(SteamStream::m, mS.value);
+    S.Set(SteamStream::T, TS);
+    S.Set(SteamStream::P, PS);
+  }
+  if (!F.IsLinked()) {
+    F.Set(LiquorStream::m, mF);
+    F.Set(LiquorStream::T, TF);
+    F.Set(LiquorStream::x, xF);
+  }
 
-  parent->SetParam("Q", Q);
-  parent->SetParam("A", A);
+  block.SetParam(Param::Q, Q.value);
+  block.SetParam(Param::A, A.value);
 }
 
 Evaporator::MethodGivenInletData::MethodGivenInletData(
     const Ref<CalculationBlock> &parent)
-    : CalculationMethod(parent, "InletDataKnown") {}
+    : ResidualMethod(RequireEvaporator(parent), "InletDataKnown") {}
 
-void Evaporator::MethodGivenInletData::Calculate() {
+void Evaporator::MethodGivenInletData::Setup(Vector &initialGuess) {
   // Assuming T in oC and P in bar
 
   // Assuming 18 variables in total:
@@ -205,133 +188,181 @@ void Evaporator::MethodGivenInletData::Calculate() {
   // C: m, T, P
   // A, Q, U
 
-  const auto &S = parent->GetInputPin("S");
-  const auto &F = parent->GetInputPin("F");
-  const auto &V = parent->GetOutputPin("V");
-  const auto &L = parent->GetOutputPin("L");
-  const auto &C = parent->GetOutputPin("C");
-
-  // Taking as known:
-  // - TF
-  // - mF
-  // - xF
-  // - PS
-  // - mS
-  // - U
-  // - A
-
-  double TF = F->GetValue("T");
-  double mF = F->GetValue("m");
-  double xF = F->GetValue("x");
-  double PS = S->GetValue("P");
-  double mS = S->GetValue("m");
-  double U = parent->GetParam("U");
-  double A = parent->GetParam("A");
-
-  // Initial estimates
-  double mL = 0;
-  double TL = 25;
-  double xL = 0.3;
-
-  double TS = 25;
-
-  double mC = 0;
-  double TC = 25;
-  double PC = 1;
-
-  double mV = 0;
-  double TV = 25;
-  double PV = 0.5;
-
-  double Q = 0;
-
-  auto system = [&](std::vector<double> x) {
-    xL = std::exp(x[0]);
-    PV = x[1];
-    // std::cout << "=============" << std::endl;
-    // std::cout << "PV " << PV << std::endl;
-    // std::cout << "xL " << xL << std::endl;
-
-    // Simple equations
-
-    // --- Mass balances
-
-    mC = mS;
-    mL = mF * xF / xL;
-    mV = mF - mL;
-
-    // --- Thermodynamics
-
-    TL = Steam::Tsat(PV) + BPR_BL(xL, PV);
-    TV = TL;
-    PC = PS;
-    TC = Steam::Tsat(PC);
-    TS = Steam::Tsat(PS);
-
-    // std::cout << "Tsat " << Steam::Tsat(PV) << std::endl;
-    // std::cout << "BPR " << BPR_BL(xL, PV) << std::endl;
-    // std::cout << "TL " << TL << std::endl;
-    // std::cout << "TC " << TC << std::endl;
-    // std::cout << "TS " << TS << std::endl;
-    //
-    // --- Energy balances
-
-    // std::cout << "EB" << std::endl;
-    Q = U * A * (TS - TL);
-
-    double hS = Steam::hV_p(PS);
-    double hC = Steam::hL_p(PC);
-    double hV = Steam::h_Tp(TV, PV);
-    double hL = h_BL(TL, xL);
-    double hF = h_BL(TF, xF);
-
-    // std::cout << "hS " << hS << std::endl;
-    // std::cout << "hC " << hC << std::endl;
-    // std::cout << "hF " << hF << std::endl;
-    // std::cout << "hL " << hL << std::endl;
-    // std::cout << "hV " << hV << std::endl;
-    // std::cout << "PS " << PS << std::endl;
-    // std::cout << "TF " << TF << std::endl;
-    // std::cout << "Q " << Q << std::endl;
-    // std::cout << "A " << A << std::endl;
-    // std::cout << "U " << U << std::endl;
-
-    double ebSteamSide = hS * mS - mC * hC - Q;
-    double ebLiquorSide = hF * mF + Q - mL * hL - mV * hV;
-
-    std::vector<double> out = {ebSteamSide, ebLiquorSide};
-    return out;
-  };
-
-  NDNewtonRaphson::SolverOptions options;
-  options.max_iterations = 100;
-  options.verbose = false;
-  options.h = 1e-6;
-
-  NDNewtonRaphson solver(system, options);
-  auto result = solver.solve({std::log(0.5), 1});
-  auto out = result.solution;
-
-  parent->SetOutputPinValue("V", "m", mV);
-  parent->SetOutputPinValue("V", "T", TV);
-  parent->SetOutputPinValue("V", "P", PV);
-
-  parent->SetOutputPinValue("C", "m", mC);
-  parent->SetOutputPinValue("C", "T", TC);
-  parent->SetOutputPinValue("C", "P", PC);
-
-  parent->SetOutputPinValue("L", "m", mL);
-  parent->SetOutputPinValue("L", "T", TL);
-  parent->SetOutputPinValue("L", "x", xL);
-
-  parent->SetInputPinValue("S", "m", mS);
-  parent->SetInputPinValue("S", "T", TS);
-  parent->SetInputPinValue("S", "P", PS);
-
-  parent->SetInputPinValue("F", "m", mF);
-  parent->SetInputPinValue("F", "T", TF);
-  parent->SetInputPinValue("F", "x", xF);
-
-  parent->SetParam("Q", Q);
-  parent->SetParam("A", A);
+  auto &block = ParentAs<Evaporator>();
+  auto S = block.In<Input::S>();
+  auto F = block.In<Input::F>();
+
+  TF = F.Get(LiquorStream::T);
+  mF = F.Get(LiquorStream::m);
+  xF = F.Get(LiquorStream::x);
+  PS = S.Get(SteamStream::P);
+  mS = S.Get(SteamStream::m);
+  U = block.GetParam(Param::U);
+  A = block.GetParam(Param::A);
+  WatchInputs({TF, mF, xF, PS, mS, U, A});
+
+  // The steam side and the feed do not depend on the unknowns
+  mC = mS;
+  PC = PS;
+  TC = Steam::Tsat(PC);
+  TS = Steam::Tsat(PS);
+
+  hS = Steam::hV_p(PS);
+  hC = Steam::hL_p(PC);
+  hF = h_BL(TF, xF);
+
+  // Initial estimates: xL (by its logarithm, so it stays positive), PV
+  initialGuess = {std::log(0.5), 1};
+
+  // Keep the solve where the correlations are defined: xL <= 1 and the
+  // vapour pressure above the triple point of water. Physical limits
+  // (xL >= xF, PV < PS) are not imposed, as tear stream iterations can pass
+  // through states that violate them.
+  lowerBounds[1] = 0.00612;
+  upperBounds[0] = 0;
+}
+
+void Evaporator::MethodGivenInletData::Residuals(const Unknowns &x,
+                                                 Unknowns &residuals) {
+  xL = exp(x[0]);
+  PV = x[1];
+
+  // --- Mass balances
+
+  mL = mF * xF / xL;
+  mV = mF - mL;
+
+  // --- Thermodynamics
+
+  TL = Steam::Tsat(PV) + BPR_BL(xL, PV);
+  TV = TL;
+
+  // --- Energy balances
+
+  Q = U * A * (TS - TL);
+
+  Number hV = Steam::h_Tp(TV, PV);
+  Number hL = h_BL(TL, xL);
+
+  Number ebSteamSide = hS * mS - mC * hC - Q;
+  Number ebLiquorSide = hF * mF + Q - mL * hL - mV * hV;
+
+  residuals = {ebSteamSide, ebLiquorSide};
+}
+
+void Evaporator::MethodGivenInletData::Store() {
+  auto &block = ParentAs<Evaporator>();
+  auto S = block.In<Input::S>();
+  auto F = block.In<Input::F>();
+  auto V = block.Out<Output::V>();
+  auto L = block.Out<Output::L>();
+  auto C = block.Out<Output::C>();
+
+  V.Set(SteamStream::m, mV.value);
+  V.Set(SteamStream::T, TV.value);
+  V.Set(SteamStream::P, PV.value);
+
+  C.Set(SteamStream::m, mC);
+  C.Set(SteamStream::T, TC);
+  C.Set(SteamStream::P, PC);
+
+  L.Set(LiquorStream::m, mL.value);
+  L.Set(LiquorStream::T, TL.value);
+  L.Set(LiquorStream::x, xL.value);
+
+  // A linked inlet is the outlet of the block upstream, which owns it
+  if (!S.IsLinked()) {
+    S.Set(SteamStream::m, mS);
+    S.Set(SteamStream::T, TS);
+    S.Set(SteamStream::P, PS);
+  }
+  if (!F.IsLinked()) {
+    F.Set(LiquorStream::m, mF);
+    F.Set(LiquorStream::T, TF);
+    F.Set(LiquorStream::x, xF);
+  }
+
+  block.SetParam(Param::Q, Q.value);
+  block.SetParam(Param::A, A);
+}
+
+void Evaporator::MethodGivenInletData::GetUnknowns(
+    std::vector<double *> &unknowns) {
+  auto &block = ParentAs<Evaporator>();
+  for (Pin *outlet : {&block.Out<Output::V>().GetPin(),
+                      &block.Out<Output::C>().GetPin(),
+                      &block.Out<Output::L>().GetPin()}) {
+    for (size_t slot = 0; slot < outlet->Size(); ++slot) {
+      unknowns.push_back(outlet->Data() + slot);
+    }
+  }
+}
+
+void Evaporator::MethodGivenInletData::EvaluateResiduals(double *residuals) {
+  // Same model as Calculate(), written as residuals over the outlet
+  // variables. Energy balances are in MW so all residuals are O(1).
+
+  auto &block = ParentAs<Evaporator>();
+  auto S = block.In<Input::S>();
+  auto F = block.In<Input::F>();
+  auto V = block.Out<Output::V>();
+  auto L = block.Out<Output::L>();
+  auto C = block.Out<Output::C>();
+
+  double TF = F.Get(LiquorStream::T);
+  double mF = F.Get(LiquorStream::m);
+  double xF = F.Get(LiquorStream::x);
+  double PS = S.Get(SteamStream::P);
+  double mS = S.Get(SteamStream::m);
+  double U = block.GetParam(Param::U);
+  double A = block.GetParam(Param::A);
+
+  double mV = V.Get(SteamStream::m);
+  double TV = V.Get(SteamStream::T);
+  double PV = V.Get(SteamStream::P);
+  double mC = C.Get(SteamStream::m);
+  double TC = C.Get(SteamStream::T);
+  double PC = C.Get(SteamStream::P);
+  double mL = L.Get(LiquorStream::m);
+  double TL = L.Get(LiquorStream::T);
+  double xL = L.Get(LiquorStream::x);
+
+  double TS = Steam::Tsat(PS);
+  double Q = U * A * (TS - TL);
+
+  double hS = Steam::hV_p(PS);
+  double hC = Steam::hL_p(PC);
+  double hV = Steam::h_Tp(TV, PV);
+  double hL = h_BL(TL, xL);
+  double hF = h_BL(TF, xF);
+
+  // --- Mass balances
+  residuals[0] = mC - mS;
+  residuals[1] = mL * xL - mF * xF;
+  residuals[2] = mV - (mF - mL);
+
+  // --- Thermodynamics
+  residuals[3] = PC - PS;
+  residuals[4] = TC - Steam::Tsat(PC);
+  residuals[5] = TL - (Steam::Tsat(PV) + BPR_BL(xL, PV));
+  residuals[6] = TV - TL;
+
+  // --- Energy balances
+  residuals[7] = (hS * mS - mC * hC - Q) / 1000;
+  residuals[8] = (hF * mF + Q - mL * hL - mV * hV) / 1000;
+}
+
+void Evaporator::MethodGivenInletData::UpdateDerivedValues() {
+  auto &block = ParentAs<Evaporator>();
+  auto S = block.In<Input::S>();
+  auto L = block.Out<Output::L>();
+
+  double TS = Steam::Tsat(S.Get(SteamStream::P));
+  double TL = L.Get(LiquorStream::T);
+
+  if (!S.IsLinked()) {
+    S.Set(SteamStream::T, TS);
+  }
+  block.SetParam(Param::Q, block.GetParam(Param::U) *
+                               block.GetParam(Param::A) * (TS - TL));
 }
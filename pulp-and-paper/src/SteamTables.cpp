@@ -0,0 +1,429 @@
+#include "SteamTables.h"
+#include "Log.h"
+#include "Steam.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const size_t INITIAL_POINTS = 33;
+const size_t MAX_SATURATION_POINTS = 65537;
+const size_t MAX_GRID_POINTS = 2049; // Per axis of the superheated grid
+
+const char FILE_MAGIC[8] = {'S', 'T', 'M', 'T', 'A', 'B', '0', '1'};
+
+struct FileHeader {
+  char magic[8];
+  double minPressure;
+  double maxPressure;
+  double maxSuperheat;
+  double tolerance;
+  uint64_t saturationCount;
+  uint64_t rowCount;
+  uint64_t columnCount;
+};
+
+// Catmull-Rom cubic through p1 (f = 0) and p2 (f = 1)
+inline double CatmullRom(double p0, double p1, double p2, double p3,
+                         double f) {
+  return p1 + 0.5 * f *
+                  ((p2 - p0) +
+                   f * ((2 * p0 - 5 * p1 + 4 * p2 - p3) +
+                        f * (3 * (p1 - p2) + p3 - p0)));
+}
+
+// Interval index and fraction of `t` (in grid steps) on an n-point grid
+inline size_t Locate(double t, size_t n, double &f) {
+  double cell = std::floor(t);
+  cell = std::max(0.0, std::min(cell, double(n - 2)));
+  f = t - cell;
+  return size_t(cell);
+}
+
+// Cubic interpolation of values[0..n) at index position i + f. The end
+// intervals extrapolate a missing neighbour linearly.
+inline double Interpolate(const double *values, size_t n, size_t i,
+                          double f) {
+  double p1 = values[i];
+  double p2 = values[i + 1];
+  double p0 = i > 0 ? values[i - 1] : 2 * p1 - p2;
+  double p3 = i + 2 < n ? values[i + 2] : 2 * p2 - p1;
+  return CatmullRom(p0, p1, p2, p3, f);
+}
+
+inline double RelativeError(double approx, double exact) {
+  return std::abs(approx - exact) / std::max(std::abs(exact), 1.0);
+}
+
+} // namespace
+
+Ref<SteamTables> SteamTables::Build() { return Build(Options()); }
+
+Ref<SteamTables> SteamTables::Build(const Options &options) {
+  if (!(options.minPressure > 0 && options.maxPressure > options.minPressure &&
+        options.maxSuperheat > 0 && options.tolerance > 0)) {
+    throw std::invalid_argument("Invalid steam table envelope");
+  }
+
+  Ref<SteamTables> tables(new SteamTables());
+  tables->options = options;
+  tables->BuildSaturation();
+  tables->BuildSuperheated();
+  return tables;
+}
+
+void SteamTables::SetGrids(size_t saturationCount, size_t rowCount,
+                           size_t columnCount) {
+  this->saturationCount = saturationCount;
+  this->rowCount = rowCount;
+  this->columnCount = columnCount;
+  this->logMin = std::log(options.minPressure);
+  double logRange = std::log(options.maxPressure) - this->logMin;
+  this->logStep = saturationCount > 1 ? logRange / (saturationCount - 1) : 0;
+  this->rowStep = rowCount > 1 ? logRange / (rowCount - 1) : 0;
+  this->superheatStep =
+      columnCount > 1 ? options.maxSuperheat / (columnCount - 1) : 0;
+}
+
+void SteamTables::AssignTables(const double *data) {
+  this->TsatTable = data;
+  this->hVTable = data + saturationCount;
+  this->hLTable = data + 2 * saturationCount;
+  this->hTable = data + 3 * saturationCount;
+}
+
+void SteamTables::BuildSaturation() {
+  // Doubling the interval count keeps the existing nodes, and the error of
+  // a cubic falls ~16x per doubling
+  for (size_t n = INITIAL_POINTS;; n = 2 * n - 1) {
+    SetGrids(n, 0, 0);
+    this->storage.assign(3 * n, 0.0);
+    AssignTables(this->storage.data());
+
+    for (size_t i = 0; i < n; ++i) {
+      double P = std::exp(this->logMin + i * this->logStep);
+      this->storage[i] = Steam::Exact::Tsat(P);
+      this->storage[n + i] = Steam::Exact::hV_p(P);
+      this->storage[2 * n + i] = Steam::Exact::hL_p(P);
+    }
+
+    double worst = 0.0;
+    for (size_t i = 0; i + 1 < n; ++i) {
+      double P = std::exp(this->logMin + (i + 0.5) * this->logStep);
+      worst = std::max({worst, RelativeError(Tsat(P), Steam::Exact::Tsat(P)),
+                        RelativeError(hV_p(P), Steam::Exact::hV_p(P)),
+                        RelativeError(hL_p(P), Steam::Exact::hL_p(P))});
+    }
+    if (worst <= options.tolerance || 2 * n - 1 > MAX_SATURATION_POINTS) {
+      if (worst > options.tolerance) {
+        SIM_LOG(Warning) << "steam saturation table error " << worst
+                         << " above tolerance at " << n << " points";
+      }
+      return;
+    }
+  }
+}
+
+void SteamTables::BuildSuperheated() {
+  size_t n = this->saturationCount;
+  std::vector<double> saturation(this->storage.begin(),
+                                 this->storage.begin() + 3 * n);
+
+  for (size_t rows = INITIAL_POINTS, columns = INITIAL_POINTS;;) {
+    SetGrids(n, rows, columns);
+    this->storage = saturation;
+    this->storage.resize(3 * n + rows * columns);
+    AssignTables(this->storage.data());
+
+    double *h = this->storage.data() + 3 * n;
+    for (size_t r = 0; r < rows; ++r) {
+      double P = std::exp(this->logMin + r * this->rowStep);
+      double T0 = Steam::Exact::Tsat(P);
+      for (size_t c = 0; c < columns; ++c) {
+        double T = T0 + c * this->superheatStep;
+        h[r * columns + c] = Steam::Exact::h_Tp(T, P);
+      }
+    }
+
+    // Worst error along each axis at cell centres, to refine only the axis
+    // that needs it
+    double worstRows = 0.0;
+    double worstColumns = 0.0;
+    for (size_t r = 0; r + 1 < rows; ++r) {
+      for (size_t c = 0; c + 1 < columns; ++c) {
+        double P = std::exp(this->logMin + (r + 0.5) * this->rowStep);
+        double PNode = std::exp(this->logMin + r * this->rowStep);
+        double superheat = (c + 0.5) * this->superheatStep;
+
+        // Between rows at a column node, and between columns on a row
+        double T = Steam::Exact::Tsat(P) + c * this->superheatStep;
+        worstRows = std::max(
+            worstRows, RelativeError(h_Tp(T, P), Steam::Exact::h_Tp(T, P)));
+        T = Steam::Exact::Tsat(PNode) + superheat;
+        worstColumns = std::max(
+            worstColumns,
+            RelativeError(h_Tp(T, PNode), Steam::Exact::h_Tp(T, PNode)));
+      }
+    }
+
+    bool rowsDone = worstRows <= options.tolerance;
+    bool columnsDone = worstColumns <= options.tolerance;
+    bool rowsCapped = 2 * rows - 1 > MAX_GRID_POINTS;
+    bool columnsCapped = 2 * columns - 1 > MAX_GRID_POINTS;
+    if ((rowsDone || rowsCapped) && (columnsDone || columnsCapped)) {
+      if (!rowsDone || !columnsDone) {
+        SIM_LOG(Warning) << "superheated steam table error "
+                         << std::max(worstRows, worstColumns)
+                         << " above tolerance at " << rows << "x" << columns
+                         << " points";
+      }
+      return;
+    }
+    if (!rowsDone && !rowsCapped) {
+      rows = 2 * rows - 1;
+    }
+    if (!columnsDone && !columnsCapped) {
+      columns = 2 * columns - 1;
+    }
+  }
+}
+
+double SteamTables::Tsat(double Pbar) const {
+  if (!(Pbar >= options.minPressure && Pbar <= options.maxPressure)) {
+    return Steam::Exact::Tsat(Pbar);
+  }
+  double f;
+  size_t i = Locate((std::log(Pbar) - logMin) / logStep, saturationCount, f);
+  return Interpolate(TsatTable, saturationCount, i, f);
+}
+
+double SteamTables::hV_p(double Pbar) const {
+  if (!(Pbar >= options.minPressure && Pbar <= options.maxPressure)) {
+    return Steam::Exact::hV_p(Pbar);
+  }
+  double f;
+  size_t i = Locate((std::log(Pbar) - logMin) / logStep, saturationCount, f);
+  return Interpolate(hVTable, saturationCount, i, f);
+}
+
+double SteamTables::hL_p(double Pbar) const {
+  if (!(Pbar >= options.minPressure && Pbar <= options.maxPressure)) {
+    return Steam::Exact::hL_p(Pbar);
+  }
+  double f;
+  size_t i = Locate((std::log(Pbar) - logMin) / logStep, saturationCount, f);
+  return Interpolate(hLTable, saturationCount, i, f);
+}
+
+double SteamTables::h_Tp(double TC, double Pbar) const {
+  if (!(Pbar >= options.minPressure && Pbar <= options.maxPressure)) {
+    return Steam::Exact::h_Tp(TC, Pbar);
+  }
+  double superheat = TC - Tsat(Pbar);
+  if (!(superheat >= 0 && superheat <= options.maxSuperheat)) {
+    return Steam::Exact::h_Tp(TC, Pbar);
+  }
+
+  double fr, fc;
+  size_t r = Locate((std::log(Pbar) - logMin) / rowStep, rowCount, fr);
+  size_t c = Locate(superheat / superheatStep, columnCount, fc);
+
+  // Interpolate along each of the four neighbouring rows, then across them
+  double p[4];
+  for (int k = 0; k < 4; ++k) {
+    long row = long(r) + k - 1;
+    if (row < 0 || row >= long(rowCount)) {
+      continue;
+    }
+    p[k] = Interpolate(hTable + row * columnCount, columnCount, c, fc);
+  }
+  if (r == 0) {
+    p[0] = 2 * p[1] - p[2];
+  }
+  if (r + 2 >= rowCount) {
+    p[3] = 2 * p[2] - p[1];
+  }
+  return CatmullRom(p[0], p[1], p[2], p[3], fr);
+}
+
+SteamTables::Deviation SteamTables::Validate(size_t samplesPerAxis) const {
+  Deviation deviation;
+  double logMax = std::log(options.maxPressure);
+
+  auto track = [&](double &worst, double approx, double exact) {
+    worst = std::max(worst, std::abs(approx - exact));
+    deviation.maxRelative =
+        std::max(deviation.maxRelative, RelativeError(approx, exact));
+    ++deviation.samples;
+  };
+
+  // Sample positions are offset by an irrational fraction of a step so they
+  // do not coincide with table nodes
+  const double OFFSET = 0.5 * (std::sqrt(5.0) - 1.0);
+  for (size_t i = 0; i < samplesPerAxis; ++i) {
+    double u = (i + OFFSET) / samplesPerAxis;
+    double P = std::exp(logMin + u * (logMax - logMin));
+    track(deviation.Tsat, Tsat(P), Steam::Exact::Tsat(P));
+    track(deviation.hV, hV_p(P), Steam::Exact::hV_p(P));
+    track(deviation.hL, hL_p(P), Steam::Exact::hL_p(P));
+
+    double T0 = Steam::Exact::Tsat(P);
+    for (size_t j = 0; j < samplesPerAxis; ++j) {
+      double T = T0 + (j + OFFSET) / samplesPerAxis * options.maxSuperheat;
+      track(deviation.h, h_Tp(T, P), Steam::Exact::h_Tp(T, P));
+    }
+  }
+  return deviation;
+}
+
+void SteamTables::PrintValidation(const Deviation &deviation,
+                                  std::ostream &out) const {
+  out << "Steam tables vs IF97 over " << options.minPressure << "-"
+      << options.maxPressure << " bar, superheat up to "
+      << options.maxSuperheat << " K (" << deviation.samples << " samples, "
+      << TableSize() << " table values)\n";
+  out << "  Tsat: max deviation " << deviation.Tsat << " K\n";
+  out << "  hV:   max deviation " << deviation.hV << " kJ/kg\n";
+  out << "  hL:   max deviation " << deviation.hL << " kJ/kg\n";
+  out << "  h:    max deviation " << deviation.h << " kJ/kg\n";
+  out << "  Max relative deviation " << deviation.maxRelative
+      << " (tolerance " << options.tolerance << ")\n";
+  out.flush();
+}
+
+void SteamTables::Save(const std::string &path) const {
+  FileHeader header;
+  std::memcpy(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC));
+  header.minPressure = options.minPressure;
+  header.maxPressure = options.maxPressure;
+  header.maxSuperheat = options.maxSuperheat;
+  header.tolerance = options.tolerance;
+  header.saturationCount = saturationCount;
+  header.rowCount = rowCount;
+  header.columnCount = columnCount;
+
+  std::ofstream file(path, std::ios::binary);
+  file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char *>(TsatTable),
+             TableSize() * sizeof(double));
+  if (!file) {
+    throw std::runtime_error("Could not write steam tables to " + path);
+  }
+}
+
+Ref<SteamTables> SteamTables::Load(const std::string &path) {
+  Ref<SteamTables> tables(new SteamTables());
+  const char *bytes = nullptr;
+  size_t size = 0;
+
+#ifndef _WIN32
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("Could not open steam tables " + path);
+  }
+  struct stat info;
+  if (fstat(fd, &info) == 0 && info.st_size > 0) {
+    size = size_t(info.st_size);
+    void *mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapped != MAP_FAILED) {
+      tables->mapping = mapped;
+      tables->mappingSize = size;
+      bytes = static_cast<const char *>(mapped);
+    }
+  }
+  close(fd);
+  if (!bytes) {
+    throw std::runtime_error("Could not map steam tables " + path);
+  }
+#else
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  if (!file) {
+    throw std::runtime_error("Could not open steam tables " + path);
+  }
+  size = size_t(file.tellg());
+  tables->storage.resize(size / sizeof(double) + 1);
+  file.seekg(0);
+  file.read(reinterpret_cast<char *>(tables->storage.data()), size);
+  bytes = reinterpret_cast<const char *>(tables->storage.data());
+#endif
+
+  FileHeader header;
+  if (size < sizeof(header)) {
+    throw std::runtime_error("Not a steam table file: " + path);
+  }
+  std::memcpy(&header, bytes, sizeof(header));
+  if (std::memcmp(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0) {
+    throw std::runtime_error("Not a steam table file: " + path);
+  }
+
+  // The envelope must be a proper range and every grid must have an
+  // interval; the counts are also bounded by the file size so that the
+  // size check below cannot overflow
+  size_t maxCount = size / sizeof(double);
+  bool validEnvelope = std::isfinite(header.minPressure) &&
+                       std::isfinite(header.maxPressure) &&
+                       std::isfinite(header.maxSuperheat) &&
+                       header.minPressure > 0 &&
+                       header.maxPressure > header.minPressure &&
+                       header.maxSuperheat > 0;
+  bool validGrids = header.saturationCount >= 2 && header.rowCount >= 2 &&
+                    header.columnCount >= 2 &&
+                    header.saturationCount <= maxCount &&
+                    header.rowCount <= maxCount &&
+                    header.columnCount <= maxCount / header.rowCount;
+  if (!validEnvelope || !validGrids) {
+    throw std::runtime_error("Invalid steam table file: " + path);
+  }
+
+  tables->options.minPressure = header.minPressure;
+  tables->options.maxPressure = header.maxPressure;
+  tables->options.maxSuperheat = header.maxSuperheat;
+  tables->options.tolerance = header.tolerance;
+  tables->SetGrids(header.saturationCount, header.rowCount,
+                   header.columnCount);
+  if (size != sizeof(header) + tables->TableSize() * sizeof(double)) {
+    throw std::runtime_error("Truncated steam table file: " + path);
+  }
+  tables->AssignTables(
+      reinterpret_cast<const double *>(bytes + sizeof(header)));
+  return tables;
+}
+
+SteamTables::~SteamTables() {
+#ifndef _WIN32
+  if (this->mapping) {
+    munmap(this->mapping, this->mappingSize);
+  }
+#endif
+}
+
+namespace Steam {
+
+std::atomic<const SteamTables *> activeTables(nullptr);
+
+// Keeps the selected tables alive
+static Ref<SteamTables> selectedTables;
+
+void UseTables(const Ref<SteamTables> &tables) {
+  activeTables.store(tables.get());
+  selectedTables = tables;
+}
+
+void UseIF97() {
+  activeTables.store(nullptr);
+  selectedTables = Ref<SteamTables>();
+}
+
+} // namespace Steam
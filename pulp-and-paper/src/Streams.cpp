@@ -0,0 +1,11 @@
+#include "Streams.h"
+
+const StreamSchema &SteamStream::Schema() {
+  static const StreamSchema schema("Steam", {"m", "T", "P"});
+  return schema;
+}
+
+const StreamSchema &LiquorStream::Schema() {
+  static const StreamSchema schema("Liquor", {"m", "T", "x"});
+  return schema;
+}
@@ -0,0 +1,7 @@
+#pragma once
+#include <string>
+
+// Self-checks run with `sandbox --check-<name>`, and by ctest. Each prints
+// what it found; RunCheck returns false if the check failed or does not
+// exist.
+bool RunCheck(const std::string &option);
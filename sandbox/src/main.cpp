@@ -1,42 +1,45 @@
+#include "Checks.h"
 #include "Evaporator.h"
 #include "Ref.h"
 #include "Simulator.h"
 #include <iostream>
 #include <vector>
 
-int main() {
-  Simulator sim;
+int main(int argc, char **argv) {
+  // `sandbox --check-<name>` runs one of the self-checks instead
+  if (argc > 1) {
+    return RunCheck(argv[1]) ? 0 : 1;
+  }
 
-  Ref<CalculationBlock> e1(new Evaporator("E1", {
-                                                    {"A", 2100},
-                                                    {"Q", 12000},
-                                                    {"U", 0.5},
-                                                    {"D", 25e-3},
+  Simulator sim;
 
-                                                }));
+  Ref<CalculationBlock> e1 = MakeRef<Evaporator>("E1", ParamsMap{
+                                                             {"A", 2100},
+                                                             {"Q", 12000},
+                                                             {"U", 0.5},
+                                                             {"D", 25e-3},
+                                                         });
 
   e1->SetInputPinValue("S", "m", 4.0);
   e1->SetInputPinValue("S", "P", 1.1);
   e1->SetInputPinValue("F", "T", 86.93);
   e1->SetInputPinValue("F", "m", 8.21);
   e1->SetInputPinValue("F", "x", 0.14);
-  e1->SetCalculationMethod(
-      Ref<CalculationMethod>(new Evaporator::MethodGivenInletData(e1)));
+  e1->SetCalculationMethod(MakeRef<Evaporator::MethodGivenInletData>(e1));
 
-  Ref<CalculationBlock> e2(new Evaporator("E2", {
-                                                    {"A", 2500},
-                                                    {"Q", 12000},
-                                                    {"U", 0.5},
-                                                    {"D", 25e-3},
-                                                }));
+  Ref<CalculationBlock> e2 = MakeRef<Evaporator>("E2", ParamsMap{
+                                                             {"A", 2500},
+                                                             {"Q", 12000},
+                                                             {"U", 0.5},
+                                                             {"D", 25e-3},
+                                                         });
 
   e2->SetInputPinValue("S", "m", 3.9);
   e2->SetInputPinValue("S", "P", 0.7);
   e2->SetInputPinValue("F", "T", 25);
   e2->SetInputPinValue("F", "m", 12);
   e2->SetInputPinValue("F", "x", 0.1);
-  e2->SetCalculationMethod(
-      Ref<CalculationMethod>(new Evaporator::MethodGivenInletData(e2)));
+  e2->SetCalculationMethod(MakeRef<Evaporator::MethodGivenInletData>(e2));
 
   std::vector<Ref<CalculationBlock>> blocks = {};
   blocks.push_back(e1);